@@ -1,55 +1,362 @@
+#define _FILE_OFFSET_BITS 64   // off_t of fseeko, for images over 2 GiB
 #include "tinyfat.h"
 #include "tinyfat_path.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifdef _WIN32
+#define host_fseek(fp, ofs) _fseeki64(fp, (int64_t)(ofs), SEEK_SET)
+#else
+#include <sys/types.h>
+#define host_fseek(fp, ofs) fseeko(fp, (off_t)(ofs), SEEK_SET)
+#endif
 
-#define MY_DISK_ID 0
+#define MY_DISK_ID     0
+#define CHECK_PATH_MAX 256   // host buffer of the paths made by the checks
 
-char* vhdfilepath;
+// host file backend, ctx is the FILE of vhd file (MBR+FAT32)
+static int vhd_read_multi(void* ctx, uint32_t sec_id, uint32_t count, uint16_t sec_size, uint8_t* data)
+{
+    FILE* vhd = (FILE*)ctx;
+    if (host_fseek(vhd, (uint64_t)sec_id * sec_size) != 0) {
+        return -1;
+    }
+    return fread(data, sec_size, count, vhd) == count ? 0 : -1;
+}
+
+static int vhd_read(void* ctx, uint32_t sec_id, uint16_t sec_size, uint8_t* data)
+{
+    return vhd_read_multi(ctx, sec_id, 1, sec_size, data);
+}
 
-int tf_disk_read(int device, uint32_t sec_id, uint16_t sec_size, uint8_t* data)
+static int vhd_write_multi(void* ctx, uint32_t sec_id, uint32_t count, uint16_t sec_size, const uint8_t* data)
 {
-    if (device != MY_DISK_ID) {
+    FILE* vhd = (FILE*)ctx;
+    if (host_fseek(vhd, (uint64_t)sec_id * sec_size) != 0) {
         return -1;
     }
+    return fwrite(data, sec_size, count, vhd) == count ? 0 : -1;
+}
+
+static int vhd_write(void* ctx, uint32_t sec_id, uint16_t sec_size, const uint8_t* data)
+{
+    return vhd_write_multi(ctx, sec_id, 1, sec_size, data);
+}
+
+static int vhd_flush(void* ctx)
+{
+    return fflush((FILE*)ctx);
+}
+
+static tf_disk_ops_t vhd_ops = {
+    .read        = vhd_read,
+    .read_multi  = vhd_read_multi,
+    .write       = vhd_write,
+    .write_multi = vhd_write_multi,
+    .flush       = vhd_flush,
+    .discard     = nullptr,   // nothing to do for a host file
+    .io_align    = 0,
+    .io_size     = 0,
+};
+
+#if TF_TRACE_SUPPORTED
+// trace sink, ctx is the FILE of trace file
+static int trace_write(void* ctx, const uint8_t* data, uint32_t size)
+{
+    return fwrite(data, 1, size, (FILE*)ctx) == size ? 0 : -1;
+}
+
+static uint32_t trace_clock(void* ctx)
+{
+    util_unused(ctx);
+    return (uint32_t)((uint64_t)clock() * 1000000 / CLOCKS_PER_SEC);
+}
+
+static tf_trace_sink_t trace_sink = {
+    .write = trace_write,
+    .clock = trace_clock,
+};
+#endif
+
+static void frag_report(const char* path)
+{
+    tf_frag_report_t report;
+    int              ret = tf_frag_scan(path, &report);
+    if (ret != 0) {
+        printf("ERROR %d\n", ret);
+        return;
+    }
+
+    printf("files: %u, fragmented: %u, clusters: %u, extents: %u\n", report.file_num, report.frag_file_num,
+           report.clus_num, report.extent_num);
+    for (int i = 0; i < TF_FRAG_HIST_NUM; i++) {
+        printf("  run %5u%s clusters: %u\n", 1u << i, i == TF_FRAG_HIST_NUM - 1 ? "+" : " ", report.run_hist[i]);
+    }
+    for (int i = 0; i < TF_FRAG_WORST_NUM && report.worst[i].extent_num > 0; i++) {
+        printf("  %s: %u extents, %u clusters\n", report.worst[i].path, report.worst[i].extent_num,
+               report.worst[i].clus_num);
+    }
+}
+
+// behavior checks of the apis changing a volume, `test <vhdfile> <file> check` on a scratch image; the files made
+// are put beside <file>, the ones kept are looked at by `make check`
+static char check_dir[CHECK_PATH_MAX - TF_FN_LEN_MAX];   // dir of <file>, "" for root
+static int  check_fail_num;                             //
+
+static void check_path(char* out, const char* name)
+{
+    snprintf(out, CHECK_PATH_MAX, "%s/%s", check_dir, name);
+}
+
+static void check_result(const char* name, int ret, bool ok)
+{
+    printf("check %-9s %s", name, (ret == 0 && ok) ? "ok\n" : "FAIL");
+    if (ret != 0 || !ok) {
+        printf(" %d\n", ret);
+        check_fail_num++;
+    }
+}
+
+// no lost or cross-linked clusters, every chain fits its size
+static bool check_volume(void)
+{
+    tf_check_report_t report;
+    if (tf_check("/", 0, &report) != 0) {
+        return false;
+    }
+    return report.lost_clus_num == 0 && report.cross_link_num == 0 && report.bad_chain_num == 0 &&
+           report.bad_size_num == 0;
+}
+
+// a copy of <file> is truncated to a byte then deleted, the volume is checked after each
+static void check_delete(const char* src)
+{
+    char      path[CHECK_PATH_MAX];
+    tf_file_t file;
+    tf_stat_t st;
+
+    check_path(path, "TFCHK0.BIN");
+    int ret = tf_copy(src, path);
+    if (ret == 0) {
+        ret = tf_item_open(path, &file);
+    }
+    if (ret == 0) {
+        ret = tf_file_truncate(&file, 1);
+    }
+    bool ok = (ret == 0 && tf_stat(path, &st) == 0 && st.size == 1 && check_volume());
+    check_result("truncate", ret, ok);
+
+    ret = tf_file_delete(path);
+    ok  = (tf_stat(path, &st) == TF_ERR_PATH && check_volume());
+    check_result("delete", ret, ok);
+}
+
+typedef struct {
+    bool skip;       // the first file is skipped by callback
+    int  file_num;   // files given to callback
+} check_walk_t;
+
+static int check_walk_item(void* ctx, const char* path, tf_item_t* item, uint16_t depth)
+{
+    check_walk_t* cw = (check_walk_t*)ctx;
+
+    util_unused(path);
+    util_unused(depth);
+    if (item->attr & TF_ATTR_DIRECTORY) {
+        return 0;
+    }
+    cw->file_num++;
+    return (cw->skip && cw->file_num == 1) ? TF_WALK_SKIP : 0;
+}
 
-    FILE* vhd = fopen(vhdfilepath, "rb");   // vhd: MBR+FAT32
-    fseek(vhd, sec_id * sec_size, SEEK_SET);
-    fread(data, 1, sec_size, vhd);
-    fclose(vhd);
+// a file skipped by the walk callback does not stop the walk, its siblings are still given
+static void check_walk(void)
+{
+    check_walk_t all  = {.skip = false};
+    check_walk_t skip = {.skip = true};
+    const char*  dir  = (check_dir[0] != '\0') ? check_dir : "/";
 
+    int ret = tf_walk(dir, check_walk_item, &all, 0);
+    if (ret == 0) {
+        ret = tf_walk(dir, check_walk_item, &skip, 0);
+    }
+    check_result("walk skip", ret, all.file_num > 1 && skip.file_num == all.file_num);
+}
+
+// a fixed time, to find it in the dir items stamped
+static int check_clock(void* ctx, tf_time_t* time)
+{
+    util_unused(ctx);
+    *time = (tf_time_t){.year = 2024, .month = 2, .day = 29, .hour = 12, .minite = 34, .second = 56};
     return 0;
 }
 
+// records are appended to a copy of <file> across a cluster boundary, the size, the data and the write time are
+// checked after remount
+static void check_append(const char* src)
+{
+    static uint8_t buffer[4096];   // whole sectors of any sector size
+    uint8_t        record[37];
+    char           path[CHECK_PATH_MAX];
+    tf_file_t      file;
+    tf_stat_t      st;
+    tf_statfs_t    sfs;
+    tf_append_t    ap;
+    uint32_t       base = 0, total = 0;
+
+    check_path(path, "TFCHK1.BIN");
+    int ret = tf_copy(src, path);
+    if (ret == 0) {
+        ret = tf_statfs("/", &sfs);
+    }
+    if (ret == 0) {
+        ret = tf_item_open(path, &file);
+    }
+    if (ret == 0) {
+        base = file.size;
+        ret  = tf_append_open(&ap, &file, buffer, sizeof(buffer), 0);
+    }
+    for (uint32_t n = 0; ret == 0 && total < sfs.clus_size + 100; total += n) {   // the last cluster is crossed
+        n = sizeof(record);
+        for (uint32_t i = 0; i < n; i++) {
+            record[i] = (uint8_t)((total + i) * 7 + 3);
+        }
+        ret = tf_append_write(&ap, record, n, 0);
+    }
+    if (ret == 0) {
+        ret = tf_append_sync(&ap);
+    }
+    if (ret == 0) {
+        tf_unmount(MY_DISK_ID);
+        ret = tf_mount(MY_DISK_ID, 'X', &vhd_ops);
+    }
+    if (ret == 0) {
+        ret = tf_stat(path, &st);
+    }
+    bool ok = (ret == 0 && st.size == base + total && st.write_time.year == 2024 && st.write_time.minite == 34);
+
+    // the data appended
+    uint32_t ofs = 0;
+    int      read;
+    if (ok) {
+        ret = tf_item_open(path, &file);
+    }
+    while (ok && ret == 0 && (read = tf_file_read(&file, buffer, sizeof(buffer))) > 0) {
+        for (int i = 0; i < read; i++, ofs++) {
+            ok = ok && (ofs < base || buffer[i] == (uint8_t)((ofs - base) * 7 + 3));
+        }
+    }
+    check_result("append", ret, ok && ofs == base + total && check_volume());
+}
+
+// the appended copy of <file> is copied again, to a new file, the data and the create time of the new one are checked
+static void check_copy(void)
+{
+    static uint8_t src_buf[512], dst_buf[512];
+    char           src_path[CHECK_PATH_MAX], dst_path[CHECK_PATH_MAX];
+    tf_file_t      src, dst;
+    tf_stat_t      st;
+
+    check_path(src_path, "TFCHK1.BIN");
+    check_path(dst_path, "TFCHK2.BIN");
+    tf_file_delete(dst_path);   // left by a check before
+    int ret = tf_copy(src_path, dst_path);
+    if (ret == 0) {
+        ret = tf_stat(dst_path, &st);
+    }
+    bool ok = (ret == 0 && st.create_time.year == 2024 && st.create_time.minite == 34);
+
+    if (ok) {
+        ret = tf_item_open(src_path, &src);
+    }
+    if (ok && ret == 0) {
+        ret = tf_item_open(dst_path, &dst);
+    }
+    ok = ok && ret == 0 && src.size == dst.size;
+    for (int n = 1; ok && n > 0;) {
+        n  = tf_file_read(&src, src_buf, sizeof(src_buf));
+        ok = (n >= 0 && tf_file_read(&dst, dst_buf, sizeof(dst_buf)) == n && memcmp(src_buf, dst_buf, n) == 0);
+    }
+    check_result("copy", ret, ok && check_volume());
+}
+
+static int check_all(const char* file)
+{
+    const char* name = strrchr(file, '/');
+    if (name == nullptr || name - file >= (int)sizeof(check_dir)) {
+        printf("ERROR path %s\n", file);
+        return 1;
+    }
+    memcpy(check_dir, file, name - file);
+    check_dir[name - file] = '\0';
+    tf_clock_set(check_clock, nullptr);
+
+    check_delete(file);
+    check_walk();
+    check_append(file);
+    check_copy();
+    return check_fail_num != 0;
+}
+
 int main(int argc, char* argv[])
 {
     int         ret;
     tf_item_t   dir, item;
     const char* path;
     uint8_t     buffer[4096] = {0};
-    char        name[16]     = {0};
+    char        name[TF_NAME_LEN_MAX] = {0};
 
     if (argc < 3) {
-        printf("usage: cmd <vhdfile> <path>\n");
+        printf("usage: cmd <vhdfile> <path> [frag|defrag|check|trace <tracefile>]\n");
         return 0;
     }
 
-    vhdfilepath = argv[1];
     path        = argv[2];
+    vhd_ops.ctx = fopen(argv[1], "r+b");
+    if (vhd_ops.ctx == nullptr) {
+        printf("ERROR open %s\n", argv[1]);
+        exit(0);
+    }
+
+#if TF_TRACE_SUPPORTED
+    if (argc > 4 && strcmp(argv[3], "trace") == 0) {   // record the accesses of mount and read, see tools/tf_replay.c
+        trace_sink.ctx = fopen(argv[4], "wb");
+        if (trace_sink.ctx == nullptr || tf_trace_start(&trace_sink) != 0) {
+            printf("ERROR trace %s\n", argv[4]);
+            exit(0);
+        }
+    }
+#endif
 
-    ret = tf_mount(MY_DISK_ID, 'X');
+    ret = tf_mount(MY_DISK_ID, 'X', &vhd_ops);
     if (ret != 0) {
         printf("ERROR %d\n", ret);
         exit(0);
     }
 
+    if (argc > 3 && strcmp(argv[3], "frag") == 0) {
+        frag_report(path);
+        tf_unmount(MY_DISK_ID);
+        return 0;
+    }
+    if (argc > 3 && strcmp(argv[3], "check") == 0) {
+        ret = check_all(path);
+        tf_unmount(MY_DISK_ID);
+        fclose((FILE*)vhd_ops.ctx);
+        return ret;
+    }
+
     ret = tf_item_open(path, &dir);
     if (ret != 0) {
         printf("ERROR %d\n", ret);
         exit(0);
     }
 
-    if (dir.attr & TF_ATTR_ARCHIVE) {
+    if (argc > 3 && strcmp(argv[3], "defrag") == 0) {
+        ret = tf_defrag_file(&dir);
+        printf("defrag %s: %d\n", path, ret);
+    } else if (!(dir.attr & TF_ATTR_DIRECTORY)) {
         printf("file<%s>:\n", path);
         int read;
 
@@ -68,11 +375,11 @@ int main(int argc, char* argv[])
 
             if (item.attr & TF_ATTR_DIRECTORY) {
                 printf("\033[34m");
-            } else {   // (item.attr & TF_ATTR_ARCHIVE)
+            } else {
                 printf("\033[32m");
             }
 
-            tf_sfn2name(item.sfn, name);
+            tf_item_get_name(&item, name);
             // printf("`%s` %s\n", item.sfn, name);
             printf("%s\033[0m ", name);
         }
@@ -80,6 +387,13 @@ int main(int argc, char* argv[])
     }
 
     tf_unmount(MY_DISK_ID);
+    fclose((FILE*)vhd_ops.ctx);
+#if TF_TRACE_SUPPORTED
+    if (trace_sink.ctx != nullptr) {
+        tf_trace_stop();
+        fclose((FILE*)trace_sink.ctx);
+    }
+#endif
 
     printf("bye.\n");
 }
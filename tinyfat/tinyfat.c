@@ -1,42 +1,45 @@
 #include "tinyfat.h"
 #include "tinyfat_mem.h"
 #include "tinyfat_path.h"
+#include "tinyfat_priv.h"
 #include "util_queue.h"
 
-#define TF_DIRITEM_SIZE           32
-#define TF_SECTOR_SIZE_MAX        512
-#define TF_CACHE_NUM              (TF_SECTOR_SIZE_MAX / 4)
-#define TF_CLUSTER_ID_VALID(clus) (clus < 0x0FFFFFF8)
-#define TF_INVALID_SECTOR_ID      0xffffffff
-#define TF_INVALID_CLUSTER_ID     0xffffffff
-#define TF_ATTR_LFN               0x0F   // lfn item
-#define TF_ATTR_DELETED           0xE5   // deleted item
-#define TF_ATTR_EMPTY             0x00   // empty
-#define TF_MASK_MATCH(attr, mask) (((attr) & (mask)) == (mask))
-
-
-struct tf_fs_t {
-    uint8_t           device;                      // device id
-    char              label;                       // label, '\0' mean not used
-    uint16_t          sec_size;                    // BS: sector size
-    uint8_t           clus_sec_num;                // BS: sector count of a cluster
-    uint32_t          sec_num_total;               // BS: sector count of volume
-    uint32_t          free_clus_num;               // FSInfo: FSI_Free_Count
-    uint32_t          next_free_clus;              // FSInfo: FSI_Nxt_Free
-    uint32_t          fat_sec_ofs;                 // sector offset of FAT area in all DISK
-    uint32_t          dat_sec_ofs;                 // sector offset of DATA area in DISK
-    uint8_t           cache[TF_SECTOR_SIZE_MAX];   //
-    uint32_t          cache_sec_id;                // cache sector id
-    uint32_t          fatcache[TF_CACHE_NUM];      // FAT table cache, next cluster id
-    uint32_t          fatcache_start;              // fatcache start cluster id
-    util_queue_node_t qnode;
-};
-
-
 static util_queue_node_t fs_list = {
     .next = &fs_list,
     .prev = &fs_list,
 };
+static uint8_t io_wait_depth;   // >0: in an operation which could not resume, see `TF_IO_WAIT`
+static int (*clock_now)(void* ctx, tf_time_t* time);   // stamps the dir items written, see `tf_clock_set`
+static void* clock_ctx;                                 // given to clock_now
+#if TF_LFN_SUPPORTTED
+static const uint8_t lfn_char_ofs[TF_LFN_CHARS] = {1, 3, 5, 7, 9, 14, 16, 18, 20, 22, 24, 28, 30};   // LDIR_Name1~3
+static uint16_t      lfn_chars[TF_NAME_LEN_MAX];   // utf-16 chars of the long name being read, the ones could be kept
+static char          lfn_name[TF_NAME_LEN_MAX];    // long name of the sfn item read last, empty if none
+#endif
+
+
+/**
+ * @brief load the FAT sector of a cluster to fatcache, from the cache pool, the sector in cache is kept
+ *
+ * @param fs
+ * @param clus_id
+ * @return int 0-ok, other-fail
+ */
+static int tf_fat_load(tf_fs_t* fs, uint32_t clus_id)
+{
+    uint32_t        start = clus_id & (~(uint32_t)(TF_CACHE_NUM - 1));
+    tf_cache_buf_t* buf;
+
+    int ret = tf_cache_get(fs, fs->fat_sec_ofs + start / TF_CACHE_NUM, TF_CACHE_META, fs->cache_buf, &buf);
+    if (ret != 0) {
+        fs->fatcache_buf = nullptr;
+        return ret;
+    }
+    fs->fatcache_buf   = buf;
+    fs->fatcache       = buf->data;
+    fs->fatcache_start = start;
+    return 0;
+}
 
 
 /**
@@ -44,465 +47,2117 @@ static util_queue_node_t fs_list = {
  *
  * @param fs
  * @param clus_id current cluster id
- * @return uint32_t
+ * @return uint32_t TF_INVALID_CLUSTER_ID if read FAT fail, TF_PENDING_CLUSTER_ID if the read is pending
  */
-static uint32_t tf_next_cluster(tf_fs_t* fs, uint32_t clus_id)
+uint32_t tf_next_cluster(tf_fs_t* fs, uint32_t clus_id)
 {
-    if (clus_id < fs->fatcache_start || clus_id - fs->fatcache_start >= TF_CACHE_NUM) {
-        // not hit
-        fs->fatcache_start = clus_id & (~(uint32_t)(TF_CACHE_NUM - 1));
-        tf_disk_read(fs->device, fs->fat_sec_ofs + fs->fatcache_start / TF_CACHE_NUM, fs->sec_size,
-                     (uint8_t*)fs->fatcache);
+    int ret = tf_fat_load(fs, clus_id);
+    if (ret != 0) {
+        return (ret == TF_PENDING) ? TF_PENDING_CLUSTER_ID : TF_INVALID_CLUSTER_ID;
     }
-    return fs->fatcache[clus_id - fs->fatcache_start];
+    return fs->fatcache[clus_id - fs->fatcache_start] & TF_FAT_ENTRY_MASK;
 }
 
 
 /**
- * @brief read one sector to cache
+ * @brief set the FAT entry of a cluster, the change is kept in the cache pool until `tf_fat_flush`, so the
+ *        entries in one FAT sector are written together
  *
  * @param fs
- * @param sec_id
- * @return int
+ * @param clus_id
+ * @param value next cluster id, TF_FAT_FREE or TF_FAT_EOC
+ * @return int 0-ok, other-fail
  */
-static int tf_fs_disk_read(tf_fs_t* fs, uint32_t sec_id)
+int tf_fat_set(tf_fs_t* fs, uint32_t clus_id, uint32_t value)
 {
-    int ret = 0;
-    if (sec_id != fs->cache_sec_id) {
-        ret = tf_disk_read(fs->device, sec_id, fs->sec_size, fs->cache);
-        if (ret == 0) {
-            fs->cache_sec_id = sec_id;
-        }
+    int ret = tf_fat_load(fs, clus_id);
+    if (ret != 0) {
+        return ret;
     }
-    return ret;
+
+    uint32_t* entry = &fs->fatcache[clus_id - fs->fatcache_start];
+    *entry                  = (*entry & ~TF_FAT_ENTRY_MASK) | (value & TF_FAT_ENTRY_MASK);   // keep the reserved high 4 bits
+    fs->fatcache_buf->dirty = true;
+    return 0;
 }
 
 
 /**
- * @brief fetch file data from disk to cache
+ * @brief write the modified FAT sectors to all FATs
  *
- * @param item: file or dir
- * @return 0-fetch ok, positive-no data, negtive-fetch fail
+ * @param fs
+ * @return int 0-ok, other-fail
  */
-static int tf_item_data_fetch(tf_item_t* item)
+int tf_fat_flush(tf_fs_t* fs)
 {
-    tf_fs_t* fs           = item->fs;
-    uint16_t cur_clus_ofs = item->cur_ofs % (fs->sec_size * fs->clus_sec_num);   // offset in current cluster
+    return tf_cache_flush(fs);
+}
 
-    // if current cluster read finished, try find next cluster
-    if (item->cur_ofs != 0 && cur_clus_ofs == 0) {
-        // find next cluster
-        uint32_t next_clus = tf_next_cluster(fs, item->cur_clus);
 
-        if (TF_CLUSTER_ID_VALID(next_clus)) {
-            item->cur_clus = next_clus;
-        } else {
-            // no next cluster
-            return 1;
+/**
+ * @brief find the first run of continuous free clusters
+ *
+ * @param fs
+ * @param num cluster count wanted
+ * @param first return the first cluster id of the run
+ * @return int 0-ok, other-fail
+ */
+int tf_fat_find_free_run(tf_fs_t* fs, uint32_t num, uint32_t* first)
+{
+    uint32_t run = 0;
+    for (uint32_t clus = 2; clus < fs->clus_num_total + 2; clus++) {
+        uint32_t entry = tf_next_cluster(fs, clus);
+        if (entry == TF_INVALID_CLUSTER_ID) {
+            return TF_ERR_DISKACCESS;
+        }
+        if (entry != TF_FAT_FREE) {
+            run = 0;
+        } else if (++run == num) {
+            *first = clus + 1 - num;
+            return 0;
+        }
+    }
+    return TF_ERR_NO_SPACE;
+}
+
+
+/**
+ * @brief allocate clusters and link them after a chain, the free ones just after the chain are taken first, so an
+ *        appended file stays continuous; nothing is allocated if there are not enough
+ *
+ * @param fs
+ * @param last last cluster of the chain, 0 for a new chain; return the last cluster allocated
+ * @param num cluster count wanted
+ * @param first return the first cluster allocated
+ * @return int 0-ok, TF_ERR_NO_SPACE-not enough free clusters, other-fail
+ */
+int tf_fat_alloc(tf_fs_t* fs, uint32_t* last, uint32_t num, uint32_t* first)
+{
+    uint32_t clus = (*last >= 2) ? *last + 1 : fs->next_free_clus;
+    uint32_t prev = *last;
+    uint32_t got  = 0;
+
+    for (uint32_t i = 0; i < fs->clus_num_total && got < num; i++, clus++) {
+        if (clus < 2 || clus >= fs->clus_num_total + 2) {   // wrap around, or no hint
+            clus = 2;
+        }
+        uint32_t entry = tf_next_cluster(fs, clus);
+        if (entry == TF_INVALID_CLUSTER_ID) {
+            return TF_ERR_DISKACCESS;
+        }
+        if (entry != TF_FAT_FREE) {
+            continue;
+        }
+        if (tf_fat_set(fs, clus, TF_FAT_EOC) != 0 || (prev >= 2 && tf_fat_set(fs, prev, clus) != 0)) {
+            return TF_ERR_DISKACCESS;
+        }
+        if (got++ == 0) {
+            *first = clus;
         }
+        prev = clus;
+    }
+    if (got == 0) {
+        return TF_ERR_NO_SPACE;
     }
 
-    uint32_t sec_id = fs->dat_sec_ofs + fs->clus_sec_num * (item->cur_clus - 2) + (cur_clus_ofs / fs->sec_size);
-    return tf_fs_disk_read(fs, sec_id);
+    int ret = tf_fs_free_count_add(fs, -(int32_t)got);
+    if (ret == 0 && got < num) {   // give back the ones got
+        ret = (*last >= 2) ? tf_fat_set(fs, *last, TF_FAT_EOC) : 0;
+        ret = (ret == 0) ? tf_fat_free_chain(fs, *first) : ret;
+        return (ret == 0) ? TF_ERR_NO_SPACE : TF_ERR_DISKACCESS;
+    }
+    fs->next_free_clus = prev + 1;
+    *last              = prev;
+    return ret == 0 ? 0 : TF_ERR_DISKACCESS;
 }
 
 
 /**
- * @brief parse a directory item from raw data
+ * @brief free a cluster chain, the free count is updated
  *
- * @param raw dir item, 32 bytes
- * @param item
+ * the entries are changed in the FAT sectors of the cache pool, so each FAT sector is written once for all its
+ * entries; each continuous extent freed is discarded, the chain should not be used by any dir item any more
+ *
+ * @param fs
+ * @param clus_id first cluster of the chain
+ * @return int 0-ok, other-fail
  */
-static void tf_item_parse(uint8_t* raw, tf_item_t* item)
+int tf_fat_free_chain(tf_fs_t* fs, uint32_t clus_id)
 {
-    uint8_t attr = (uint8_t)util_bytes2uint_le(raw + 11, 1);   // DIR_Attr  11  1
+    uint32_t run_first = clus_id;
+    uint32_t num       = 0;
 
-    if (attr == 0 || raw[0] == 0) {
-        item->attr = TF_ATTR_EMPTY;
-    } else if (raw[0] == 0xE5) {
-        item->attr = TF_ATTR_DELETED;
-    } else if (TF_MASK_MATCH(attr, TF_ATTR_LFN)) {
-        // lfn, will be ignored
-        item->attr = attr;
-    } else {
-        // sfn
-        item->attr = attr;
+    while (TF_CLUSTER_ID_VALID(clus_id) && clus_id >= 2) {
+        if (clus_id >= fs->clus_num_total + 2 || num >= fs->clus_num_total) {   // broken chain
+            break;
+        }
 
-        memcpy(item->sfn, raw + 0, 11);   // DIR_Name
-        item->sfn[TF_SFN_LEN - 1] = '\0';
+        uint32_t next = tf_next_cluster(fs, clus_id);
+        if (next == TF_INVALID_CLUSTER_ID || tf_fat_set(fs, clus_id, TF_FAT_FREE) != 0) {
+            break;
+        }
+        num++;
 
-        uint16_t temp           = (uint16_t)util_bytes2uint_le(raw + 24, 2);   // DIR_WrtDate
-        item->write_time.year   = 1980 + (temp >> 9);
-        item->write_time.month  = (temp >> 9) & 0x0F;
-        item->write_time.day    = temp & 0x1F;
-        temp                    = (uint16_t)util_bytes2uint_le(raw + 22, 2);   // DIR_WrtTime
-        item->write_time.year   = temp >> 11;
-        item->write_time.month  = (temp >> 5) & 0x3F;
-        item->write_time.day    = temp & 0x1F;
-        temp                    = (uint16_t)util_bytes2uint_le(raw + 16, 2);   // DIR_CrtDate
-        item->create_time.year  = 1980 + (temp >> 9);
-        item->create_time.month = (temp >> 9) & 0x0F;
-        item->create_time.day   = temp & 0x1F;
-        temp                    = (uint16_t)util_bytes2uint_le(raw + 14, 2);   // DIR_CrtTime
-        item->create_time.year  = temp >> 11;
-        item->create_time.month = (temp >> 5) & 0x3F;
-        item->create_time.day   = temp & 0x1F;
+        if (next != clus_id + 1) {   // extent end
+            tf_fs_discard(fs, run_first, clus_id + 1 - run_first);
+            run_first = next;
+        }
+        clus_id = next;
+    }
 
-        item->first_clus = (util_bytes2uint_le(raw + 20, 2) << 16) | util_bytes2uint_le(raw + 26, 2);
-        item->size       = util_bytes2uint_le(raw + 28, 4);
-        item->cur_clus   = item->first_clus;
-        item->cur_ofs    = 0;
+    int ret = tf_fs_free_count_add(fs, num);
+    if (tf_fat_flush(fs) != 0 || ret != 0 || (TF_CLUSTER_ID_VALID(clus_id) && clus_id >= 2)) {   // stopped early
+        return TF_ERR_DISKACCESS;
     }
+    return 0;
 }
 
 
 /**
- * @brief
+ * @brief enter an operation which could not resume, the pending reads in it are asked again until done
+ */
+void tf_io_wait_begin(void)
+{
+    io_wait_depth++;
+}
+
+
+/**
+ * @brief leave the operation entered by `tf_io_wait_begin`
  *
- * @param path like 'xxx/xxx/xxx'
- * @param name
- * @return int
+ * @param ret result of the operation
+ * @return int ret
  */
-static int tf_get_base_of_path(const char* path, char* name)
+int tf_io_wait_end(int ret)
 {
-    int i = 0;
-    while (path[i] != '\0' && path[i] != '/' && i < TF_FN_LEN_MAX) {
-        name[i] = path[i];
-        i++;
-    }
-    if (path[i] != '\0' && path[i] != '/') {
-        return TF_ERR_LFN_NOT_SUPPORTED;
-    }
-    name[i] = '\0';
-    return i;
+    io_wait_depth--;
+    return ret;
 }
 
 
 /**
- * @brief find item of subpath from a dir
+ * @brief read sectors by the ops of device, a pending read is asked again until done in `TF_IO_WAIT`
  *
- * @param dir
- * @param subpath not start by '/'
- * @param item return the item found in the dir
- * @return int 0-ok
+ * @param fs
+ * @param sec_id first sector id
+ * @param count sector count, more than 1 only if the device has multi-sector read
+ * @param buffer should be large enough to store `count` sectors
+ * @return int 0-ok, TF_PENDING-read not done, other-fail
  */
-static int tf_item_find(const tf_item_t* dir, const char* subpath, tf_item_t* item)
+int tf_fs_disk_read_op(tf_fs_t* fs, uint32_t sec_id, uint32_t count, uint8_t* buffer)
 {
-    if (dir == nullptr || subpath == nullptr || item == nullptr) {
-        return TF_ERR_PARAM;
-    }
-    if (!TF_MASK_MATCH(dir->attr, TF_ATTR_DIRECTORY)) {
-        return TF_ERR_PARAM;
+    const tf_disk_ops_t* ops = fs->ops;
+    int                  ret;
+
+    tf_prof_begin();
+    do {
+        ret = (count > 1) ? ops->read_multi(ops->ctx, sec_id, count, fs->sec_size, buffer)
+                          : ops->read(ops->ctx, sec_id, fs->sec_size, buffer);
+    } while (ret == TF_PENDING && io_wait_depth > 0);
+    return tf_prof_end(TF_PROF_DISK_READ, ret);
+}
+
+
+/**
+ * @brief read one sector to cache, from the cache pool, the sector in fatcache is kept
+ *
+ * @param fs
+ * @param sec_id
+ * @param kind TF_CACHE_META for FAT, dir and other fs sectors, TF_CACHE_DATA for file data
+ * @return int
+ */
+int tf_fs_disk_read(tf_fs_t* fs, uint32_t sec_id, uint8_t kind)
+{
+    tf_cache_buf_t* buf;
+
+    int ret = tf_cache_get(fs, sec_id, kind, fs->fatcache_buf, &buf);
+    if (ret != 0) {
+        fs->cache_buf    = nullptr;
+        fs->cache_sec_id = TF_INVALID_SECTOR_ID;
+        return ret;
     }
+    fs->cache_buf    = buf;
+    fs->cache        = (uint8_t*)buf->data;
+    fs->cache_sec_id = sec_id;
+    return 0;
+}
 
-    static tf_item_t base;
-    static char      name[TF_FN_LEN_MAX] = {0};
-    static char      sfn[TF_SFN_LEN]     = {0};
 
-    memcpy(&base, dir, sizeof(tf_item_t));
+/**
+ * @brief write one sector to disk, the cache is kept the same as disk
+ *
+ * @param fs
+ * @param sec_id
+ * @param data
+ * @return int 0-ok, other-fail
+ */
+int tf_fs_disk_write(tf_fs_t* fs, uint32_t sec_id, const uint8_t* data)
+{
+    return tf_fs_disk_write_burst(fs, sec_id, 1, data);
+}
 
-    while (true) {
-        tf_logger("[%s] enter dir `%s`, try find `%s`\n", __func__, dir->sfn, subpath);
 
-        if (subpath[0] == '\0') {
-            // subpath like "a/b/c/"
-            tf_logger("[%s] found `%s`\n", __func__, subpath);
-            memcpy(item, &base, sizeof(tf_item_t));
-            return 0;
-        }
+/**
+ * @brief sector count of the next multi-sector i/o, no more than the preferred size, and if split, it ends at the
+ *        preferred alignment
+ *
+ * @param fs
+ * @param sec_id first sector id
+ * @param count sector count left
+ * @return uint32_t
+ */
+static uint32_t tf_fs_io_chunk(tf_fs_t* fs, uint32_t sec_id, uint32_t count)
+{
+    uint32_t align = fs->ops->io_align;
+    uint32_t num   = count;
 
-        if (subpath[0] == '/') {
-            return TF_ERR_PATH;
+    if (fs->ops->io_size != 0 && num > fs->ops->io_size) {
+        num = fs->ops->io_size;
+    }
+    if (align > 1 && num < count) {
+        uint32_t end = (sec_id + num) / align * align;
+        if (end > sec_id) {
+            num = end - sec_id;
         }
+    }
+    return num;
+}
 
-        // first part of subpath
-        int sep = tf_get_base_of_path(subpath, name);
-        tf_name2sfn(name, sfn);
-
-        bool part_found = false;
-        while (tf_dir_read(&base, item) == 0) {
-            if (strcmp(item->sfn, sfn) == 0) {
-                if (strcmp(name, "..") == 0 && item->first_clus == 0) {   // upper is the root dir
-                    item->cur_clus = item->first_clus = 2;
-                }
 
-                if (subpath[sep] == '\0') {   // item is the wanted file/dir
-                    tf_logger("[%s] found `%s`\n", __func__, subpath);
-                    return 0;
-                }
+/**
+ * @brief count the free entries of a piece of FAT
+ *
+ * 4 entries a round without branch, so the compiler could vectorize it
+ *
+ * @param fat FAT entries
+ * @param num entry count
+ * @return uint32_t free entry count
+ */
+static uint32_t tf_fat_count_free(const uint32_t* fat, uint32_t num)
+{
+    uint32_t count = 0;
+    uint32_t i     = 0;
 
-                // confirm item is a dir
-                if (!TF_MASK_MATCH(item->attr, TF_ATTR_DIRECTORY)) {
-                    return TF_ERR_PATH;
-                }
+    for (; i + 4 <= num; i += 4) {
+        count += ((fat[i + 0] & TF_FAT_ENTRY_MASK) == 0) + ((fat[i + 1] & TF_FAT_ENTRY_MASK) == 0) +
+                 ((fat[i + 2] & TF_FAT_ENTRY_MASK) == 0) + ((fat[i + 3] & TF_FAT_ENTRY_MASK) == 0);
+    }
+    for (; i < num; i++) {
+        count += ((fat[i] & TF_FAT_ENTRY_MASK) == 0);
+    }
+    return count;
+}
 
-                memcpy(&base, item, sizeof(tf_item_t));
-                subpath += sep + 1;
-                part_found = true;
-                break;
-            }
-        }
-        if (!part_found) {
-            return TF_ERR_PATH;
+
+/**
+ * @brief read continuous sectors to buffer directly, the cache is bypassed
+ *
+ * multi-sector read of the device is used if it has, otherwise sector by sector
+ *
+ * @param fs
+ * @param sec_id first sector id
+ * @param count sector count
+ * @param buffer should be large enough to store `count` sectors
+ * @return int 0-ok, TF_PENDING-read not done, all the sectors are read again next time, other-fail
+ */
+int tf_fs_disk_read_burst(tf_fs_t* fs, uint32_t sec_id, uint32_t count, uint8_t* buffer)
+{
+    const tf_disk_ops_t* ops = fs->ops;
+
+    tf_trace_record(fs, sec_id, count, TF_TRACE_DIRECT);
+    while (count > 0) {
+        uint32_t num = (ops->read_multi != nullptr) ? tf_fs_io_chunk(fs, sec_id, count) : 1;
+        int      ret = tf_fs_disk_read_op(fs, sec_id, num, buffer);
+        if (ret != 0) {
+            return ret;
         }
+        sec_id += num;
+        count -= num;
+        buffer += num << TF_SEC_SHIFT(fs);
     }
+    return 0;
 }
 
 
-int tf_mount(int device, char label)
+/**
+ * @brief write continuous sectors from buffer, the cache is kept the same as disk
+ *
+ * multi-sector write of the device is used if it has, otherwise sector by sector
+ *
+ * @param fs
+ * @param sec_id first sector id
+ * @param count sector count
+ * @param buffer `count` sectors
+ * @return int 0-ok, TF_ERR_NOT_SUPPORTED-read only device, other-fail
+ */
+int tf_fs_disk_write_burst(tf_fs_t* fs, uint32_t sec_id, uint32_t count, const uint8_t* buffer)
 {
-    tf_fs_t* fs         = nullptr;
-    uint16_t volume_ofs = 0;   // fat32 volume sector offset
+    const tf_disk_ops_t* ops = fs->ops;
+    if (ops->write == nullptr) {
+        return TF_ERR_NOT_SUPPORTED;
+    }
 
-    util_queue_foreach(node, &fs_list)
-    {
-        tf_fs_t* tmp = util_containerof(tf_fs_t, qnode, node);
-        if (tmp->label == label) {
-            return TF_ERR_MOUNT_LABEL_USED;
+    tf_snap_drop(fs, sec_id, count);
+    tf_cache_update(fs, sec_id, count, buffer);
+    tf_trace_record(fs, sec_id, count, TF_TRACE_WRITE);
+
+    while (count > 0) {
+        uint32_t num = (ops->write_multi != nullptr) ? tf_fs_io_chunk(fs, sec_id, count) : 1;
+        tf_prof_begin();
+        int ret = (num > 1) ? ops->write_multi(ops->ctx, sec_id, num, fs->sec_size, buffer)
+                            : ops->write(ops->ctx, sec_id, fs->sec_size, buffer);
+        tf_prof_end(TF_PROF_DISK_WRITE, ret);
+        if (ret != 0) {
+            tf_cache_drop(fs, sec_id, count);   // not sure what is on disk
+            return ret;
         }
+        sec_id += num;
+        count -= num;
+        buffer += num << TF_SEC_SHIFT(fs);
     }
+    return 0;
+}
 
-    fs = (tf_fs_t*)tf_malloc(sizeof(tf_fs_t));
-    memset(fs, 0, sizeof(tf_fs_t));
-    fs->label          = label;
-    fs->device         = device;
-    fs->sec_size       = TF_DEFALUT_SECTOR_SIZE;
-    fs->cache_sec_id   = TF_INVALID_SECTOR_ID;
-    fs->fatcache_start = TF_INVALID_CLUSTER_ID;
 
-    tf_logger("[%s] fs label='%c', device=%d\n", __func__, fs->label, fs->device);
+/**
+ * @brief make the written data durable, if the device could
+ *
+ * @param fs
+ * @return int 0-ok, other-fail
+ */
+int tf_fs_disk_flush(tf_fs_t* fs)
+{
+    return (fs->ops->flush != nullptr) ? TF_PROF(TF_PROF_DISK_FLUSH, fs->ops->flush(fs->ops->ctx)) : 0;
+}
 
-#if TF_WITH_MBR
-    // read first sector, find first FAT32(LBA) partition
-    tf_fs_disk_read(fs, 0);
 
-    int i = 0;
-    for (i = 0; i < 4; i++) {
-        if (util_bytes2uint_le(fs->cache + 446 + 16 * i + 4, 1) == 0x0C) {   // 0x0C: FAT32 (LBA)
-            volume_ofs = util_bytes2uint_le(fs->cache + 446 + 16 * i + 8, 4);
-            break;
-        }
-    }
-    if (i == 4) {   // no fat32lba partition
-        tf_free(fs);
-        return TF_ERR_NO_FAT32LBA;
+/**
+ * @brief tell the device the sectors of some continuous clusters are not used any more, if the device could
+ *
+ * @param fs
+ * @param first_clus
+ * @param clus_num
+ * @return int 0-ok, other-fail
+ */
+int tf_fs_discard(tf_fs_t* fs, uint32_t first_clus, uint32_t clus_num)
+{
+    if (fs->ops->discard == nullptr || clus_num == 0) {
+        return 0;
     }
-#endif
-
-    tf_logger("[%s] fs sector offset=%d\n", __func__, volume_ofs);
+    return TF_PROF(TF_PROF_DISK_DISCARD,
+                   fs->ops->discard(fs->ops->ctx, TF_CLUS2SEC(fs, first_clus), clus_num << TF_CLUS_SEC_SHIFT(fs)));
+}
 
-    util_queue_insert(&fs_list, &fs->qnode);
 
-    // read Boot sector, make sure the volume is FAT32LBA
-    if (tf_fs_disk_read(fs, volume_ofs) != 0) {
-        tf_free(fs);
+/**
+ * @brief count free clusters by scanning the whole FAT, several sectors a read
+ *
+ * @param fs
+ * @return int 0-ok, other-fail
+ */
+int tf_fs_count_free(tf_fs_t* fs)
+{
+    uint32_t  sec_num  = TF_FAT_SCAN_SEC_NUM;
+    uint32_t* buffer   = (uint32_t*)tf_malloc(sec_num * fs->sec_size);
+    uint32_t  ent_num  = fs->clus_num_total + 2;   // entry 0 and 1 are reserved
+    uint32_t  ent_done = 0;
+    uint32_t  count    = 0;
+
+    if (buffer == nullptr) {   // no memory for a large buffer, FAT sector by sector through the cache pool
+        sec_num = 1;
+    } else if (tf_fat_flush(fs) != 0) {   // the modified FAT sectors are read from disk
+        tf_free(buffer);
         return TF_ERR_DISKACCESS;
     }
 
-    fs->sec_size            = util_bytes2uint_le(fs->cache + 11, 2);   // BPB_BytsPerSec
-    fs->clus_sec_num        = util_bytes2uint_le(fs->cache + 13, 1);   // BPB_SecPerClus
-    uint16_t resv_sec_num   = util_bytes2uint_le(fs->cache + 14, 2);   // BPB_RsvdSecCnt
-    uint8_t  fat_num        = util_bytes2uint_le(fs->cache + 16, 1);   // BPB_NumFATs
-    uint32_t hidden_sec_num = util_bytes2uint_le(fs->cache + 28, 4);   // BPB_HiddSec
-    fs->sec_num_total       = util_bytes2uint_le(fs->cache + 32, 4);   // BPB_TotSec32
-    uint32_t fat_sec_num    = util_bytes2uint_le(fs->cache + 36, 4);   // BPB_FATSz32
-    uint16_t fsinfo_sec     = util_bytes2uint_le(fs->cache + 48, 2);   // BPB_FSInfo
-
-    util_unused(hidden_sec_num);
+    uint32_t ent_per_read = sec_num * fs->sec_size / 4;
 
-    tf_logger("[%s] fs sec_size=%d\n", __func__, fs->sec_size);
-    tf_logger("[%s] fs clus_sec_num=%d\n", __func__, fs->clus_sec_num);
-    tf_logger("[%s] fs resv_sec_num=%d\n", __func__, resv_sec_num);
-    tf_logger("[%s] fs fat_num=%d\n", __func__, fat_num);
-    tf_logger("[%s] fs hidden_sec_num=%d\n", __func__, hidden_sec_num);
-    tf_logger("[%s] fs sec_num_total=%d\n", __func__, fs->sec_num_total);
-    tf_logger("[%s] fs fat_sec_num=%d\n", __func__, fat_sec_num);
-    tf_logger("[%s] fs fsinfo_sec=%d\n", __func__, fsinfo_sec);
+    for (uint32_t sec = 0; ent_done < ent_num; sec += sec_num) {
+        uint32_t  n    = util_min2(sec_num, fs->fat_sec_num - sec);
+        uint32_t* ents = buffer;
+        if (n == 0) {
+            break;
+        }
+        if (buffer == nullptr) {
+            if (tf_fat_load(fs, sec * TF_CACHE_NUM) != 0) {
+                break;
+            }
+            ents = fs->fatcache;
+        } else if (tf_fs_disk_read_burst(fs, fs->fat_sec_ofs + sec, n, (uint8_t*)buffer) != 0) {
+            break;
+        }
 
-    if (fs->sec_size > TF_SECTOR_SIZE_MAX) {
-        tf_free(fs);
-        return TF_ERR_SECTORSIZE;
+        uint32_t ent_now = util_min2(ent_per_read, ent_num - ent_done);
+        count += tf_fat_count_free(ents, ent_now);
+        if (ent_done == 0) {
+            count -= tf_fat_count_free(ents, 2);   // reserved entries are not clusters
+        }
+        ent_done += ent_now;
     }
 
-    // read FSInfo sector
-    if (tf_fs_disk_read(fs, volume_ofs + fsinfo_sec) != 0) {
-        tf_free(fs);
+    if (buffer != nullptr) {
+        tf_free(buffer);
+    }
+    if (ent_done < ent_num) {
         return TF_ERR_DISKACCESS;
     }
 
-    fs->free_clus_num  = util_bytes2uint_le(fs->cache + 488, 4);   // FSI_Free_Count
-    fs->next_free_clus = util_bytes2uint_le(fs->cache + 492, 4);   // FSI_Nxt_Free
-    tf_logger("[%s] fs free_clus_num=%d\n", __func__, fs->free_clus_num);
-    tf_logger("[%s] fs next_free_clus=%d\n", __func__, fs->next_free_clus);
-
-    fs->fat_sec_ofs = volume_ofs + resv_sec_num;
-    fs->dat_sec_ofs = fs->fat_sec_ofs + fat_sec_num * fat_num;
-    tf_logger("[%s] fs fat_sec_ofs=%d\n", __func__, fs->fat_sec_ofs);
-    tf_logger("[%s] fs dat_sec_ofs=%d\n", __func__, fs->dat_sec_ofs);
-
+    fs->free_clus_num = count;
     return 0;
 }
 
 
-int tf_unmount(int device)
-{
-    tf_fs_t* fs = nullptr;
-    util_queue_foreach(node, &fs_list)
-    {
-        tf_fs_t* tmp = util_containerof(tf_fs_t, qnode, node);
-        if (tmp->device == device) {
-            fs = tmp;
-            break;
-        }
+/**
+ * @brief write the free count and next free cluster to FSInfo
+ *
+ * @param fs
+ * @param free_count TF_INVALID_FREE_COUNT-unknown
+ * @return int 0-ok, other-fail
+ */
+static int tf_fs_fsinfo_write(tf_fs_t* fs, uint32_t free_count)
+{
+    int ret = tf_fs_disk_read(fs, fs->fsinfo_sec_id, TF_CACHE_META);
+    if (ret != 0) {
+        return ret;
     }
-
-    if (fs == nullptr) {
-        return TF_ERR_DEV_NOTMOUNT;
+    if (util_bytes2uint_le(fs->cache + 0, 4) != TF_FSI_LEAD_SIG ||
+        util_bytes2uint_le(fs->cache + 484, 4) != TF_FSI_STRUC_SIG) {   // no valid FSInfo, nothing to keep
+        return 0;
     }
 
-    util_queue_remove(&fs->qnode);
-    tf_free(fs);
-    return 0;
+    util_uint2bytes_le(fs->cache + 488, free_count, 4);           // FSI_Free_Count
+    util_uint2bytes_le(fs->cache + 492, fs->next_free_clus, 4);   // FSI_Nxt_Free
+    ret = tf_fs_disk_write(fs, fs->fsinfo_sec_id, fs->cache);
+    if (ret == 0) {
+        tf_snap_stamp(fs, free_count);
+    }
+    return ret;
 }
 
 
-int tf_item_open(const char* path, tf_item_t* item)
+/**
+ * @brief change the free cluster count, FSInfo is updated lazily
+ *
+ * the count on disk is marked unknown at the first change, and the real one is written at unmount, so FSInfo is
+ * written twice a mount at most and a power loss leaves no wrong count
+ *
+ * @param fs
+ * @param num clusters freed, negtive-clusters allocated
+ * @return int 0-ok, other-fail
+ */
+int tf_fs_free_count_add(tf_fs_t* fs, int32_t num)
 {
-    if (path == nullptr || item == nullptr) {
-        return TF_ERR_PARAM;
+    if (num == 0) {
+        return 0;
     }
-
-    int pathlen = strlen(path);
-    if (pathlen == 0) {
-        return TF_ERR_PATH;
+    if (fs->free_clus_num != TF_INVALID_FREE_COUNT) {
+        fs->free_clus_num += num;
     }
-    if (!(path[0] == '/') && !(pathlen >= 3 && path[1] == ':' && path[2] == '/')) {
-        return TF_ERR_PATH;
+    if (fs->fsinfo_dirty || fs->fsinfo_sec_id == TF_INVALID_SECTOR_ID) {
+        return 0;
     }
+    fs->fsinfo_dirty = true;
+    return tf_fs_fsinfo_write(fs, TF_INVALID_FREE_COUNT);
+}
 
-    const char* subpath = nullptr;
-    tf_fs_t*    fs      = nullptr;
 
-    if (!util_queue_empty(&fs_list)) {
-        if (path[0] == '/') {
-            subpath = &path[1];
-            fs      = util_containerof(tf_fs_t, qnode, fs_list.next);
+/**
+ * @brief locate the sector of item data at current offset
+ *
+ * @param item: file or dir
+ * @param sec_id return the sector id
+ * @return 0-ok, positive-no data, TF_PENDING-FAT read not done
+ */
+static int tf_item_data_locate(tf_item_t* item, uint32_t* sec_id)
+{
+    tf_fs_t* fs           = item->fs;
+    uint32_t cur_clus_ofs = item->cur_ofs & TF_CLUS_MASK(fs);   // offset in current cluster
+
+    // if current cluster read finished, try find next cluster
+    if (item->cur_ofs != 0 && cur_clus_ofs == 0) {
+        // find next cluster
+        uint32_t next_clus;
+        if (item->flags & TF_ITEM_NO_FAT_CHAIN) {   // continuous clusters, FAT is not used
+            next_clus = (item->cur_ofs < item->size) ? item->cur_clus + 1 : TF_FAT_EOC;
         } else {
-            util_queue_foreach(node, &fs_list)
-            {
-                tf_fs_t* tmp = util_containerof(tf_fs_t, qnode, node);
-                if (tmp->label == path[0]) {
-                    fs      = tmp;
-                    subpath = &path[3];
-                    break;
-                }
-            }
+            next_clus = tf_next_cluster(fs, item->cur_clus);
+        }
+        if (next_clus == TF_PENDING_CLUSTER_ID) {
+            return TF_PENDING;
+        }
+
+        if (TF_CLUSTER_ID_VALID(next_clus)) {
+            item->cur_clus = next_clus;
+        } else {
+            // no next cluster
+            return 1;
         }
     }
-    if (fs == nullptr) {
-        return TF_ERR_PATH;
+
+    *sec_id = TF_CLUS2SEC(fs, item->cur_clus) + (cur_clus_ofs >> TF_SEC_SHIFT(fs));
+    return 0;
+}
+
+
+/**
+ * @brief fetch file data from disk to cache, the dir data is cached as meta
+ *
+ * @param item: file or dir
+ * @return 0-fetch ok, positive-no data, TF_PENDING-read not done, other negtive-fetch fail
+ */
+int tf_item_data_fetch(tf_item_t* item)
+{
+    uint32_t sec_id = 0;
+    int      ret    = tf_item_data_locate(item, &sec_id);
+    if (ret != 0) {
+        return ret;
     }
+    uint8_t kind = TF_MASK_MATCH(item->attr, TF_ATTR_DIRECTORY) ? TF_CACHE_META : TF_CACHE_DATA;
+    return tf_fs_disk_read(item->fs, sec_id, kind);
+}
 
-    // set item as root dir, cluster id start at 2
-    item->fs         = fs;
-    item->attr       = TF_ATTR_DIRECTORY;
-    item->sfn[0]     = fs->label;
-    item->sfn[1]     = '\0';
-    item->first_clus = 2;   // cluster no. start from 2
+
+/**
+ * @brief calculate the checksum of a sfn, kept in its lfn items
+ *
+ * @param sfn raw name, 11 bytes
+ * @return uint8_t
+ */
+static uint8_t tf_sfn_checksum(const uint8_t* sfn)
+{
+    uint8_t sum = 0;
+    for (int i = 0; i < 11; i++) {
+        sum = ((sum & 1) << 7) + (sum >> 1) + sfn[i];
+    }
+    return sum;
+}
+
+
+/**
+ * @brief parse a sfn directory item from raw data, time info is kept raw, the long name is the one read with it
+ *
+ * @param fs
+ * @param raw dir item, 32 bytes, points into the fs cache
+ * @param item
+ */
+static void tf_item_parse(tf_fs_t* fs, uint8_t* raw, tf_item_t* item)
+{
+    item->attr  = (uint8_t)util_bytes2uint_le(raw + 11, 1);   // DIR_Attr  11  1
+    item->flags = 0;
+
+    memcpy(item->sfn, raw + 0, 11);   // DIR_Name
+    item->sfn[TF_SFN_LEN - 1] = '\0';
+#if TF_LFN_SUPPORTTED
+    strcpy(item->name, lfn_name);   // read with raw by `tf_dir_read_raw`
+#elif TF_EXFAT_SUPPORTED
+    item->name[0] = '\0';
+#endif
+    memcpy(item->raw, raw, TF_DIRITEM_SIZE);
+
+    item->first_clus = (util_bytes2uint_le(raw + 20, 2) << 16) | util_bytes2uint_le(raw + 26, 2);
+    item->size       = util_bytes2uint_le(raw + 28, 4);
     item->cur_clus   = item->first_clus;
     item->cur_ofs    = 0;
-
-    // search subpath
-    return tf_item_find(item, subpath, item);
+    item->hint_clus  = item->first_clus;
+    item->hint_ofs   = 0;
+    item->raw_sec    = fs->cache_sec_id;
+    item->raw_ofs    = raw - fs->cache;
+    item->fs         = fs;
 }
 
 
-int tf_item_close(tf_item_t* item)
+/**
+ * @brief write the raw dir item of item back to disk
+ *
+ * @param item
+ * @return int 0-ok, other-fail
+ */
+int tf_item_raw_update(tf_item_t* item)
 {
-    if (item == nullptr) {
+    tf_fs_t* fs = item->fs;
+    if (item->raw_sec == TF_INVALID_SECTOR_ID) {
         return TF_ERR_PARAM;
     }
-    memset(item, 0, sizeof(tf_item_t));
-    return 0;
+
+    int ret = tf_fs_disk_read(fs, item->raw_sec, TF_CACHE_META);
+    if (ret != 0) {
+        return ret;
+    }
+    memcpy(fs->cache + item->raw_ofs, item->raw, TF_DIRITEM_SIZE);
+    return tf_fs_disk_write(fs, item->raw_sec, fs->cache);
 }
 
 
-int tf_dir_read(tf_dir_t* dir, tf_item_t* item)
+/**
+ * @brief decode fat date and time
+ *
+ * @param date raw date, bit 15-9: year from 1980, bit 8-5: month, bit 4-0: day
+ * @param time raw time, bit 15-11: hour, bit 10-5: minute, bit 4-0: 2-second count
+ * @param t
+ */
+static void tf_time_decode(uint16_t date, uint16_t time, tf_time_t* t)
 {
-    if (dir == nullptr || item == nullptr) {
-        return TF_ERR_PARAM;
+    t->year   = 1980 + (date >> 9);
+    t->month  = (date >> 5) & 0x0F;
+    t->day    = date & 0x1F;
+    t->hour   = time >> 11;
+    t->minite = (time >> 5) & 0x3F;
+    t->second = (time & 0x1F) * 2;
+}
+
+
+/**
+ * @brief stamp a raw dir item by the clock set, the write time, and the create time of a new item; left as it is
+ *        without clock
+ *
+ * @param raw dir item, 32 bytes
+ * @param create a new item
+ */
+void tf_item_stamp(uint8_t* raw, bool create)
+{
+    tf_time_t t;
+    if (clock_now == nullptr || clock_now(clock_ctx, &t) != 0 || t.year < 1980 || t.year > 2107) {
+        return;
     }
-    if (!TF_MASK_MATCH(dir->attr, TF_ATTR_DIRECTORY)) {
-        return TF_ERR_PARAM;
+
+    uint16_t date = ((t.year - 1980) << 9) | (t.month << 5) | t.day;
+    uint16_t time = (t.hour << 11) | (t.minite << 5) | (t.second / 2);
+    util_uint2bytes_le(raw + 22, time, 2);   // DIR_WrtTime
+    util_uint2bytes_le(raw + 24, date, 2);   // DIR_WrtDate
+    util_uint2bytes_le(raw + 18, date, 2);   // DIR_LstAccDate
+    if (create) {
+        raw[13] = (t.second & 1) * 100;          // DIR_CrtTimeTenth
+        util_uint2bytes_le(raw + 14, time, 2);   // DIR_CrtTime
+        util_uint2bytes_le(raw + 16, date, 2);   // DIR_CrtDate
+    }
+}
+
+
+/**
+ * @brief make the search key of a name, the sfn if it is 8.3, and the upcased utf-16 chars for the lfn items
+ *
+ * @param key
+ * @param name
+ */
+static void tf_name_key_init(tf_name_key_t* key, const char* name)
+{
+    key->sfn_ok = (tf_name2sfn(name, key->sfn) == 0);
+
+#if TF_LFN_SUPPORTTED
+    uint16_t c;
+    int      n;
+
+    key->len = 0;
+    while ((n = tf_utf8_decode(name, &c)) > 0 && key->len < TF_NAME_LEN_MAX) {
+        key->fold[key->len++] = tf_char_upcase(c);
+        name += n;
+    }
+#endif
+}
+
+
+#if TF_LFN_SUPPORTTED
+/**
+ * @brief take a lfn item into the run of lfn items before a sfn item
+ *
+ * the first item of a run holds the last part of name, so the name length is known there; with key, the run is
+ * dropped at once if the length differs, the other items of it are dropped by the order check, so the long names
+ * not wanted cost O(1) each item; the chars of the wanted length are compared with key
+ *
+ * @param run
+ * @param p the lfn item
+ * @param key the name wanted, could be nullptr
+ */
+static void tf_lfn_take(tf_lfn_run_t* run, uint8_t* p, const tf_name_key_t* key)
+{
+    uint8_t ord = p[0] & 0x3F;   // LDIR_Ord
+
+    if (p[0] & TF_LFN_LAST) {   // a new run
+        uint8_t num = 0;
+        while (num < TF_LFN_CHARS && util_bytes2uint_le(p + lfn_char_ofs[num], 2) != 0) {
+            num++;
+        }
+        run->len  = (ord - 1) * TF_LFN_CHARS + num;
+        run->next = ord;
+        run->sum  = p[13];   // LDIR_Chksum
+        if (ord == 0 || ord > TF_LFN_ORD_MAX || (key != nullptr && run->len != key->len)) {
+            run->len = 0;
+        }
+    }
+    if (run->len == 0 || ord != run->next || p[13] != run->sum) {   // broken or not wanted
+        run->len = 0;
+        return;
+    }
+    run->next--;
+
+    uint16_t pos = (ord - 1) * TF_LFN_CHARS;
+    for (uint8_t i = 0; i < TF_LFN_CHARS && pos + i < run->len && pos + i < TF_NAME_LEN_MAX; i++) {
+        uint16_t c = util_bytes2uint_le(p + lfn_char_ofs[i], 2);
+        if (key != nullptr && tf_char_upcase(c) != key->fold[pos + i]) {
+            run->len = 0;
+            return;
+        }
+        lfn_chars[pos + i] = c;
+    }
+}
+
+
+/**
+ * @brief end the run of lfn items at a sfn item, the long name is made if the run is whole and of the sfn
+ *
+ * @param run
+ * @param sfn the sfn item
+ */
+static void tf_lfn_end(tf_lfn_run_t* run, const uint8_t* sfn)
+{
+    uint16_t pos = 0;
+
+    if (run->len != 0 && run->next == 0 && run->sum == tf_sfn_checksum(sfn)) {
+        for (uint16_t i = 0; i < run->len && i < TF_NAME_LEN_MAX; i++) {
+            uint16_t end = tf_utf8_append(lfn_name, pos, lfn_chars[i]);
+            if (end == pos) {   // cut
+                break;
+            }
+            pos = end;
+        }
+    }
+    lfn_name[pos] = '\0';
+    run->len      = 0;
+}
+#endif
+
+
+/**
+ * @brief check if a sfn item just read is the name wanted, by its sfn or its long name
+ *
+ * @param key
+ * @param raw the sfn item
+ * @return bool
+ */
+static bool tf_name_key_match(const tf_name_key_t* key, const uint8_t* raw)
+{
+    if (key->sfn_ok && memcmp(raw, key->sfn, 11) == 0) {   // only compare DIR_Name
+        return true;
     }
+#if TF_LFN_SUPPORTTED
+    return lfn_name[0] != '\0';   // made only if the lfn items match key
+#else
+    return false;
+#endif
+}
+
 
-    tf_fs_t* fs          = dir->fs;
-    uint32_t dir_ofs_bak = dir->cur_ofs;
+/**
+ * @brief read next sfn item from dir, deleted items are skipped, the lfn items before it make its long name
+ *
+ * @param dir
+ * @param raw return the raw sfn item, points into the fs cache
+ * @param key the name wanted, the long name is made only if it matches; nullptr, it is always made
+ * @return int 0-ok, positive-has end, TF_PENDING-read not done, the dir stops at the item being read, other
+ *             negtive-fail
+ */
+static int tf_dir_read_raw(tf_dir_t* dir, uint8_t** raw, const tf_name_key_t* key)
+{
+    tf_fs_t* fs           = dir->fs;
+    uint32_t dir_ofs_bak  = 0;   // where the current run of lfn items starts
+    uint32_t dir_clus_bak = 0;
+#if TF_LFN_SUPPORTTED
+    tf_lfn_run_t run = {0};
+#else
+    util_unused(key);
+#endif
 
     while (true) {
+#if TF_LFN_SUPPORTTED
+        if (run.len == 0)
+#endif
+        {
+            dir_ofs_bak  = dir->cur_ofs;
+            dir_clus_bak = dir->cur_clus;
+        }
+
         int prefetch = tf_item_data_fetch(dir);
-        if (prefetch < 0) {
-            dir->cur_ofs = dir_ofs_bak;
-            return TF_ERR_DISKACCESS;
+        if (prefetch < 0) {   // read the lfn items again next time
+            dir->cur_ofs  = dir_ofs_bak;
+            dir->cur_clus = dir_clus_bak;
+            return (prefetch == TF_PENDING) ? TF_PENDING : TF_ERR_DISKACCESS;
         }
         if (prefetch > 0) {
             return 1;
         }
 
-        tf_item_parse(fs->cache + (dir->cur_ofs % fs->sec_size), item);
+        uint8_t* p    = fs->cache + (dir->cur_ofs & TF_SEC_MASK(fs));
+        uint8_t  attr = p[11];   // DIR_Attr
         dir->cur_ofs += TF_DIRITEM_SIZE;
 
-        item->fs = dir->fs;
-
-        if (item->attr == TF_ATTR_EMPTY) {   // empty item, end
+        if (attr == 0 || p[0] == TF_ATTR_EMPTY) {   // empty item, end
             return 1;
         }
-        if (item->attr == TF_ATTR_DELETED) {   // deleted item, ignore it
+        if (p[0] == TF_ATTR_DELETED) {   // deleted item, ignore it
+#if TF_LFN_SUPPORTTED
+            run.len = 0;
+#endif
             continue;
         }
-        if (TF_MASK_MATCH(item->attr, TF_ATTR_LFN)) {   // lfn item, ignore it
+        if (TF_MASK_MATCH(attr, TF_ATTR_LFN)) {   // lfn item
+#if TF_LFN_SUPPORTTED
+            tf_lfn_take(&run, p, key);
+#endif
             continue;
-        } else {   // sfn
-            return 0;
         }
+#if TF_LFN_SUPPORTTED
+        tf_lfn_end(&run, p);
+#endif
+        *raw = p;   // sfn
+        return 0;
     }
 }
 
 
-int tf_file_read(tf_file_t* file, uint8_t* buffer, uint32_t size)
+/**
+ * @brief
+ *
+ * @param path like 'xxx/xxx/xxx'
+ * @param name
+ * @param max size of name buffer
+ * @return int length of base, negtive-fail
+ */
+static int tf_get_base_of_path(const char* path, char* name, int max)
 {
-    if (file == nullptr || buffer == nullptr) {
-        return TF_ERR_PARAM;
+    int i = 0;
+    while (path[i] != '\0' && path[i] != '/' && i < max - 1) {
+        name[i] = path[i];
+        i++;
     }
-    if (!TF_MASK_MATCH(file->attr, TF_ATTR_ARCHIVE)) {
-        return TF_ERR_PARAM;
+    if (path[i] != '\0' && path[i] != '/') {
+        return TF_ERR_LFN_NOT_SUPPORTED;
+    }
+    name[i] = '\0';
+    return i;
+}
+
+
+/**
+ * @brief search a name in dir, start at the hint of dir and wrap around once
+ *
+ * for FAT32, sfn of the name is compared, and the long name is assembled and compared only if the lfn items could
+ * match, see `tf_lfn_take`; for exfat, the name hash and length are compared first, the name is assembled and
+ * compared only if they match
+ *
+ * @param dir the hint is moved to the item after the found one; with TF_ITEM_PENDING, the search goes on at the
+ *            current offset of dir, the flag is set again if the search is pending
+ * @param name
+ * @param item return the item found, not changed if not found
+ * @return int 0-found, positive-not found, TF_PENDING-read not done, other negtive-fail
+ */
+static int tf_dir_search(tf_dir_t* dir, const char* name, tf_item_t* item)
+{
+    static tf_name_key_t name_key;
+    uint32_t             stop_ofs = dir->hint_ofs;     // the wrapped search stops here
+    bool                 wrapped  = (stop_ofs == 0);   // search from the start, no need to wrap
+    uint8_t*             raw      = nullptr;
+
+    if (dir->flags & TF_ITEM_PENDING) {   // go on where the pending read stopped
+        wrapped = wrapped || (dir->flags & TF_ITEM_WRAPPED);
+        dir->flags &= ~(TF_ITEM_PENDING | TF_ITEM_WRAPPED);
+    } else {
+        dir->cur_clus = dir->hint_clus;
+        dir->cur_ofs  = dir->hint_ofs;
+    }
+
+#if TF_EXFAT_SUPPORTED
+    static tf_item_t found;
+    tf_exfat_key_t   key;
+    if (dir->fs->type == TF_FS_EXFAT) {
+        tf_exfat_key_init(&key, name);
+    } else
+#endif
+    {
+        tf_name_key_init(&name_key, name);
     }
 
-    uint32_t size_read    = 0;
-    tf_fs_t* fs           = file->fs;
-    uint32_t file_ofs_bak = file->cur_ofs;
+    while (true) {
+        if (wrapped && stop_ofs != 0 && dir->cur_ofs >= stop_ofs) {
+            return 1;
+        }
 
-    size = util_min2(size, file->size - file->cur_ofs);
+        int ret;
+#if TF_EXFAT_SUPPORTED
+        if (dir->fs->type == TF_FS_EXFAT) {
+            ret = tf_exfat_dir_read(dir, &found, &key);   // only the matched one is returned
+        } else
+#endif
+        {
+            ret = tf_dir_read_raw(dir, &raw, &name_key);
+            if (ret == 0 && !tf_name_key_match(&name_key, raw)) {
+                continue;
+            }
+        }
 
-    while (size_read < size) {
-        int ret = tf_item_data_fetch(file);
         if (ret < 0) {
-            file->cur_ofs = file_ofs_bak;
-            return TF_ERR_DISKACCESS;
+            if (ret == TF_PENDING) {
+                dir->flags |= TF_ITEM_PENDING | (wrapped ? TF_ITEM_WRAPPED : 0);
+            }
+            return ret;
+        }
+        if (ret > 0) {
+            if (wrapped) {
+                return 1;
+            }
+            wrapped       = true;
+            dir->cur_clus = dir->first_clus;
+            dir->cur_ofs  = 0;
+            continue;
         }
 
-        if (ret > 0) {   // no data to fetch
-            break;
+        dir->hint_clus = dir->cur_clus;
+        dir->hint_ofs  = dir->cur_ofs;
+#if TF_EXFAT_SUPPORTED
+        if (dir->fs->type == TF_FS_EXFAT) {
+            memcpy(item, &found, sizeof(tf_item_t));
+            return 0;
         }
+#endif
+        tf_item_parse(dir->fs, raw, item);   // only the matched one is parsed
+        return 0;
+    }
+}
 
-        // read the data in current sector
-        uint16_t ofs     = file->cur_ofs % fs->sec_size;
-        uint16_t readnow = util_min2(size, fs->sec_size - ofs);
 
-        memcpy(&buffer[size_read], &fs->cache[ofs], readnow);
-        file->cur_ofs += readnow;
-        size_read += readnow;
+/**
+ * @brief find item of subpath from a dir
+ *
+ * the search state is kept in item if a read is pending: the dir being searched, with TF_ITEM_PENDING, and the
+ * part of subpath searched in it; the search goes on there if called again with the same subpath and item
+ *
+ * @param dir the hint of dir is updated when the first part of subpath found
+ * @param subpath not start by '/'
+ * @param item return the item found in the dir
+ * @return int 0-ok, TF_PENDING-read not done, other-fail
+ */
+static int tf_item_find(tf_item_t* dir, const char* subpath, tf_item_t* item)
+{
+    if (dir == nullptr || subpath == nullptr || item == nullptr) {
+        return TF_ERR_PARAM;
+    }
+    if (!TF_MASK_MATCH(dir->attr, TF_ATTR_DIRECTORY)) {
+        return TF_ERR_PARAM;
+    }
+
+    static tf_item_t base;
+    static char      name[TF_NAME_LEN_MAX] = {0};
+
+    const char* path     = subpath;
+    uint32_t    dir_clus = dir->first_clus;   // dir may be the same as item
+
+    if ((item->flags & TF_ITEM_PENDING) && item->pend_path == path) {   // go on with the pending search
+        memcpy(&base, item, sizeof(tf_item_t));
+        item->flags &= ~(TF_ITEM_PENDING | TF_ITEM_WRAPPED);
+        subpath += item->pend_ofs;
+    } else {
+        memcpy(&base, dir, sizeof(tf_item_t));
+    }
+
+    while (true) {
+        tf_logger("[%s] enter dir `%s`, try find `%s`\n", __func__, dir->sfn, subpath);
+
+        if (subpath[0] == '\0') {
+            // subpath like "a/b/c/"
+            tf_logger("[%s] found `%s`\n", __func__, subpath);
+            memcpy(item, &base, sizeof(tf_item_t));
+            return 0;
+        }
+
+        if (subpath[0] == '/') {
+            return TF_ERR_PATH;
+        }
+
+        // first part of subpath
+        int sep = tf_get_base_of_path(subpath, name,
+                                      (TF_LFN_SUPPORTTED || base.fs->type == TF_FS_EXFAT) ? TF_NAME_LEN_MAX : TF_FN_LEN_MAX);
+        if (sep < 0) {
+            return sep;
+        }
+
+        int ret = tf_dir_search(&base, name, item);
+        if (ret == TF_PENDING) {
+            memcpy(item, &base, sizeof(tf_item_t));
+            item->pend_path = path;
+            item->pend_ofs  = subpath - path;
+            return ret;
+        }
+        if (ret != 0) {
+            return TF_ERR_PATH;
+        }
+        if (base.first_clus == dir_clus && item != dir) {   // searched in dir, keep the hint for next time
+            dir->hint_clus = base.hint_clus;
+            dir->hint_ofs  = base.hint_ofs;
+        }
+
+        if (strcmp(name, "..") == 0 && item->first_clus == 0) {   // upper is the root dir
+            item->cur_clus = item->first_clus = item->hint_clus = base.fs->root_clus;
+        }
+
+        if (subpath[sep] == '\0') {   // item is the wanted file/dir
+            tf_logger("[%s] found `%s`\n", __func__, subpath);
+            return 0;
+        }
+
+        // confirm item is a dir
+        if (!TF_MASK_MATCH(item->attr, TF_ATTR_DIRECTORY)) {
+            return TF_ERR_PATH;
+        }
+
+        memcpy(&base, item, sizeof(tf_item_t));
+        subpath += sep + 1;
+    }
+}
+
+
+/**
+ * @brief free a volume, its buffers in the cache pool are dropped
+ *
+ * @param fs
+ */
+static void tf_fs_free(tf_fs_t* fs)
+{
+    tf_cache_weight(fs, 0);
+    tf_cache_drop(fs, 0, TF_INVALID_SECTOR_ID);
+    if (fs->snap != nullptr) {
+        tf_free(fs->snap);
+    }
+    tf_free(fs);
+}
+
+
+/**
+ * @brief mount a volume, see `tf_mount`
+ *
+ * @param device
+ * @param label
+ * @param ops
+ * @return int 0-ok, other-fail
+ */
+static int tf_fs_mount(int device, char label, const tf_disk_ops_t* ops)
+{
+    tf_fs_t* fs         = nullptr;
+    uint32_t volume_ofs = 0;   // fat32 volume sector offset
+
+    util_queue_foreach(node, &fs_list)
+    {
+        tf_fs_t* tmp = util_containerof(tf_fs_t, qnode, node);
+        if (tmp->label == label) {
+            return TF_ERR_MOUNT_LABEL_USED;
+        }
+    }
+
+    if (ops == nullptr || ops->read == nullptr) {
+        return TF_ERR_PARAM;
+    }
+
+    fs = (tf_fs_t*)tf_malloc(sizeof(tf_fs_t));
+    memset(fs, 0, sizeof(tf_fs_t));
+    fs->label          = label;
+    fs->device         = device;
+    fs->ops            = ops;
+    fs->sec_size       = TF_DEFALUT_SECTOR_SIZE;
+    fs->cache_sec_id   = TF_INVALID_SECTOR_ID;
+    fs->fsinfo_sec_id  = TF_INVALID_SECTOR_ID;
+
+    tf_logger("[%s] fs label='%c', device=%d\n", __func__, fs->label, fs->device);
+
+#if TF_WITH_MBR
+    // read first sector, find first FAT32(LBA) partition
+    tf_fs_disk_read(fs, 0, TF_CACHE_META);
+
+    uint8_t  part_type[4];
+    uint32_t part_ofs[4];
+    for (int i = 0; i < 4; i++) {   // kept, the cache is taken by the boot sector probed
+        part_type[i] = util_bytes2uint_le(fs->cache + 446 + 16 * i + 4, 1);
+        part_ofs[i]  = util_bytes2uint_le(fs->cache + 446 + 16 * i + 8, 4);
+    }
+
+    int i = 0;
+    for (i = 0; i < 4; i++) {
+        if (part_type[i] == 0x0C) {   // FAT32 (LBA)
+            volume_ofs = part_ofs[i];
+            break;
+        }
+        if (TF_EXFAT_SUPPORTED && part_type[i] == 0x07 && tf_fs_disk_read(fs, part_ofs[i], TF_CACHE_META) == 0 &&
+            memcmp(fs->cache + 3, "EXFAT   ", 8) == 0) {   // 0x07: exFAT, or NTFS/HPFS
+            volume_ofs = part_ofs[i];
+            break;
+        }
+    }
+    if (i == 4) {   // no fat32lba partition
+        tf_fs_free(fs);
+        return TF_ERR_NO_FAT32LBA;
+    }
+#endif
+
+    tf_logger("[%s] fs sector offset=%d\n", __func__, volume_ofs);
+
+    // read Boot sector, make sure the volume is FAT32LBA
+    if (tf_fs_disk_read(fs, volume_ofs, TF_CACHE_META) != 0) {
+        tf_fs_free(fs);
+        return TF_ERR_DISKACCESS;
+    }
+
+#if TF_EXFAT_SUPPORTED
+    if (memcmp(fs->cache + 3, "EXFAT   ", 8) == 0) {   // FileSystemName
+        int ret = tf_exfat_mount(fs, volume_ofs);
+        if (ret != 0) {
+            tf_fs_free(fs);
+            return ret;
+        }
+        tf_cache_weight(fs, 1);
+        util_queue_insert(&fs_list, &fs->qnode);
+        return 0;
+    }
+#endif
+
+    fs->sec_size            = util_bytes2uint_le(fs->cache + 11, 2);   // BPB_BytsPerSec
+    fs->clus_sec_num        = util_bytes2uint_le(fs->cache + 13, 1);   // BPB_SecPerClus
+    uint16_t resv_sec_num   = util_bytes2uint_le(fs->cache + 14, 2);   // BPB_RsvdSecCnt
+    fs->fat_num             = util_bytes2uint_le(fs->cache + 16, 1);   // BPB_NumFATs
+    uint32_t hidden_sec_num = util_bytes2uint_le(fs->cache + 28, 4);   // BPB_HiddSec
+    fs->sec_num_total       = util_bytes2uint_le(fs->cache + 32, 4);   // BPB_TotSec32
+    fs->fat_sec_num         = util_bytes2uint_le(fs->cache + 36, 4);   // BPB_FATSz32
+    fs->root_clus           = util_bytes2uint_le(fs->cache + 44, 4);   // BPB_RootClus
+    uint16_t fsinfo_sec     = util_bytes2uint_le(fs->cache + 48, 2);   // BPB_FSInfo
+    uint32_t vol_id         = util_bytes2uint_le(fs->cache + 67, 4);   // BS_VolID
+
+    util_unused(hidden_sec_num);
+
+    tf_logger("[%s] fs sec_size=%d\n", __func__, fs->sec_size);
+    tf_logger("[%s] fs clus_sec_num=%d\n", __func__, fs->clus_sec_num);
+    tf_logger("[%s] fs resv_sec_num=%d\n", __func__, resv_sec_num);
+    tf_logger("[%s] fs fat_num=%d\n", __func__, fs->fat_num);
+    tf_logger("[%s] fs hidden_sec_num=%d\n", __func__, hidden_sec_num);
+    tf_logger("[%s] fs sec_num_total=%d\n", __func__, fs->sec_num_total);
+    tf_logger("[%s] fs fat_sec_num=%d\n", __func__, fs->fat_sec_num);
+    tf_logger("[%s] fs fsinfo_sec=%d\n", __func__, fsinfo_sec);
+
+    if (fs->sec_size > TF_SECTOR_SIZE_MAX) {
+        tf_fs_free(fs);
+        return TF_ERR_SECTORSIZE;
+    }
+
+    // sector size and cluster size are pow of 2, offsets are calculated by shift and mask
+    while ((1u << fs->sec_shift) < fs->sec_size) {
+        fs->sec_shift++;
+    }
+    while ((1u << fs->clus_sec_shift) < fs->clus_sec_num) {
+        fs->clus_sec_shift++;
+    }
+    if ((1u << fs->sec_shift) != fs->sec_size || (1u << fs->clus_sec_shift) != fs->clus_sec_num ||
+        fs->sec_size != TF_SEC_SIZE(fs) || fs->clus_sec_num != TF_CLUS_SEC_NUM(fs)) {   // not the fixed geometry
+        tf_fs_free(fs);
+        return TF_ERR_SECTORSIZE;
+    }
+
+    // read FSInfo sector
+    if (tf_fs_disk_read(fs, volume_ofs + fsinfo_sec, TF_CACHE_META) != 0) {
+        tf_fs_free(fs);
+        return TF_ERR_DISKACCESS;
+    }
+
+    fs->fat_sec_ofs    = volume_ofs + resv_sec_num;
+    fs->dat_sec_ofs    = fs->fat_sec_ofs + fs->fat_sec_num * fs->fat_num;
+    fs->clus_num_total = (fs->sec_num_total - (fs->dat_sec_ofs - volume_ofs)) >> fs->clus_sec_shift;
+    tf_logger("[%s] fs fat_sec_ofs=%d\n", __func__, fs->fat_sec_ofs);
+    tf_logger("[%s] fs dat_sec_ofs=%d\n", __func__, fs->dat_sec_ofs);
+    tf_logger("[%s] fs clus_num_total=%d\n", __func__, fs->clus_num_total);
+
+    fs->fsinfo_sec_id  = volume_ofs + fsinfo_sec;
+    fs->free_clus_num  = util_bytes2uint_le(fs->cache + 488, 4);   // FSI_Free_Count
+    fs->next_free_clus = util_bytes2uint_le(fs->cache + 492, 4);   // FSI_Nxt_Free
+    if (util_bytes2uint_le(fs->cache + 0, 4) != TF_FSI_LEAD_SIG ||     // FSI_LeadSig
+        util_bytes2uint_le(fs->cache + 484, 4) != TF_FSI_STRUC_SIG ||   // FSI_StrucSig
+        fs->free_clus_num > fs->clus_num_total) {
+        fs->free_clus_num = TF_INVALID_FREE_COUNT;   // recount when needed
+    }
+    tf_logger("[%s] fs free_clus_num=%d\n", __func__, fs->free_clus_num);
+    tf_logger("[%s] fs next_free_clus=%d\n", __func__, fs->next_free_clus);
+
+    tf_snap_load(fs, vol_id);
+    tf_cache_weight(fs, 1);
+    util_queue_insert(&fs_list, &fs->qnode);
+    return 0;
+}
+
+
+int tf_mount(int device, char label, const tf_disk_ops_t* ops)
+{
+    return TF_PROF(TF_PROF_MOUNT, TF_IO_WAIT(tf_fs_mount(device, label, ops)));
+}
+
+
+int tf_unmount(int device)
+{
+    tf_fs_t* fs = nullptr;
+    util_queue_foreach(node, &fs_list)
+    {
+        tf_fs_t* tmp = util_containerof(tf_fs_t, qnode, node);
+        if (tmp->device == device) {
+            fs = tmp;
+            break;
+        }
+    }
+
+    if (fs == nullptr) {
+        return TF_ERR_DEV_NOTMOUNT;
+    }
+
+    tf_prof_begin();
+    tf_io_wait_begin();
+    int ret = tf_fat_flush(fs);
+    if (ret == 0 && fs->fsinfo_dirty) {
+        ret = tf_fs_fsinfo_write(fs, fs->free_clus_num);
+    }
+    if (ret == 0) {
+        ret = tf_fs_disk_flush(fs);
+    }
+    if (ret == 0) {   // a snapshot not saved only makes a cold start
+        tf_snap_save(fs);
+    }
+    tf_prof_end(TF_PROF_UNMOUNT, tf_io_wait_end(ret));
+    util_queue_remove(&fs->qnode);
+    tf_fs_free(fs);
+    return ret;
+}
+
+
+int tf_clock_set(int (*now)(void* ctx, tf_time_t* time), void* ctx)
+{
+    clock_now = now;
+    clock_ctx = ctx;
+    return 0;
+}
+
+
+int tf_cache_set_weight(int device, uint8_t weight)
+{
+    util_queue_foreach(node, &fs_list)
+    {
+        tf_fs_t* fs = util_containerof(tf_fs_t, qnode, node);
+        if (fs->device == device) {
+            tf_cache_weight(fs, weight);
+            return 0;
+        }
+    }
+    return TF_ERR_DEV_NOTMOUNT;
+}
+
+
+/**
+ * @brief set item as the root dir of the volume in the path
+ *
+ * @param path absolute path, like "/xxx" or "x:/xxx"
+ * @param item the root dir, result value
+ * @param subpath the path relative to the root dir, result value
+ * @return int 0-ok, other-fail
+ */
+static int tf_item_open_root(const char* path, tf_item_t* item, const char** subpath)
+{
+    int pathlen = strlen(path);
+    if (pathlen == 0) {
+        return TF_ERR_PATH;
+    }
+    if (!(path[0] == '/') && !(pathlen >= 3 && path[1] == ':' && path[2] == '/')) {
+        return TF_ERR_PATH;
+    }
+
+    tf_fs_t* fs = nullptr;
+
+    if (!util_queue_empty(&fs_list)) {
+        if (path[0] == '/') {
+            *subpath = &path[1];
+            fs       = util_containerof(tf_fs_t, qnode, fs_list.next);
+        } else {
+            util_queue_foreach(node, &fs_list)
+            {
+                tf_fs_t* tmp = util_containerof(tf_fs_t, qnode, node);
+                if (tmp->label == path[0]) {
+                    fs       = tmp;
+                    *subpath = &path[3];
+                    break;
+                }
+            }
+        }
+    }
+    if (fs == nullptr) {
+        return TF_ERR_PATH;
+    }
+
+    // set item as root dir, cluster id start at 2
+    item->fs         = fs;
+    item->attr       = TF_ATTR_DIRECTORY;
+    item->flags      = 0;
+    item->sfn[0]     = fs->label;
+    item->sfn[1]     = '\0';
+#if TF_LONG_NAME_SUPPORTED
+    item->name[0] = '\0';
+#endif
+    item->size       = 0;
+    item->first_clus = fs->root_clus;
+    item->cur_clus   = item->first_clus;
+    item->cur_ofs    = 0;
+    item->hint_clus  = item->first_clus;
+    item->hint_ofs   = 0;
+    item->raw_sec    = TF_INVALID_SECTOR_ID;   // root dir has no dir item
+    item->raw_ofs    = 0;
+    memset(item->raw, 0, TF_DIRITEM_SIZE);
+    return 0;
+}
+
+
+/**
+ * @brief fill the stat info of an item
+ *
+ * @param item
+ * @param st
+ */
+static void tf_item_stat(const tf_item_t* item, tf_stat_t* st)
+{
+    memset(st, 0, sizeof(tf_stat_t));
+    st->attr       = item->attr;
+    st->size       = item->size;
+    st->first_clus = item->first_clus;
+    memcpy(st->sfn, item->sfn, TF_SFN_LEN);
+    tf_item_get_name(item, st->name);
+    tf_item_get_times(item, &st->write_time, &st->create_time);   // root dir has no time info
+}
+
+
+/**
+ * @brief get space info of a volume, see `tf_statfs`
+ *
+ * @param path
+ * @param st
+ * @return int 0-ok, other-fail
+ */
+static int tf_fs_statfs(const char* path, tf_statfs_t* st)
+{
+    if (path == nullptr || st == nullptr) {
+        return TF_ERR_PARAM;
+    }
+
+    tf_item_t   root;
+    const char* subpath = nullptr;
+    int         ret     = tf_item_open_root(path, &root, &subpath);
+    if (ret != 0) {
+        return ret;
+    }
+
+    tf_fs_t* fs = root.fs;
+    if (fs->free_clus_num == TF_INVALID_FREE_COUNT) {   // FSInfo not trusted, count once and keep it
+#if TF_EXFAT_SUPPORTED
+        ret = TF_IO_WAIT((fs->type == TF_FS_EXFAT) ? tf_exfat_count_free(fs) : tf_fs_count_free(fs));
+#else
+        ret = TF_IO_WAIT(tf_fs_count_free(fs));
+#endif
+        if (ret != 0) {
+            return ret;
+        }
+    }
+
+    st->clus_size   = TF_CLUS_SIZE(fs);
+    st->total_clus  = fs->clus_num_total;
+    st->free_clus   = fs->free_clus_num;
+    st->total_bytes = (uint64_t)st->total_clus * st->clus_size;
+    st->free_bytes  = (uint64_t)st->free_clus * st->clus_size;
+    return 0;
+}
+
+
+int tf_statfs(const char* path, tf_statfs_t* st)
+{
+    return TF_PROF(TF_PROF_STATFS, tf_fs_statfs(path, st));
+}
+
+
+/**
+ * @brief open an item by absolute path, see `tf_item_open`
+ *
+ * @param path
+ * @param item
+ * @return int 0-ok, TF_PENDING-disk read not done, other-fail
+ */
+static int tf_item_open_path(const char* path, tf_item_t* item)
+{
+    if (path == nullptr || item == nullptr) {
+        return TF_ERR_PARAM;
+    }
+
+    static tf_item_t root;   // item may keep a pending search, not set as the root dir
+    const char*      subpath = nullptr;
+    int              ret     = tf_item_open_root(path, &root, &subpath);
+    if (ret != 0) {
+        return ret;
+    }
+    if (tf_snap_find(root.fs, path, item)) {   // warm start
+        return 0;
+    }
+
+    // search subpath
+    ret = tf_item_find(&root, subpath, item);
+    if (ret == 0) {
+        tf_snap_add(root.fs, path, item);
+    }
+    return ret;
+}
+
+
+int tf_item_open(const char* path, tf_item_t* item)
+{
+    return TF_PROF(TF_PROF_ITEM_OPEN, tf_item_open_path(path, item));
+}
+
+
+/**
+ * @brief open an item by path relative to a dir, see `tf_item_openat`
+ *
+ * @param dir
+ * @param subpath
+ * @param item
+ * @return int 0-ok, TF_PENDING-disk read not done, other-fail
+ */
+static int tf_item_open_at(tf_dir_t* dir, const char* subpath, tf_item_t* item)
+{
+    if (dir == nullptr || subpath == nullptr || item == nullptr) {
+        return TF_ERR_PARAM;
+    }
+    if (subpath[0] == '/' || (subpath[0] != '\0' && subpath[1] == ':')) {   // absolute path, dir is ignored
+        return tf_item_open_path(subpath, item);
+    }
+    return tf_item_find(dir, subpath, item);
+}
+
+
+int tf_item_openat(tf_dir_t* dir, const char* subpath, tf_item_t* item)
+{
+    return TF_PROF(TF_PROF_ITEM_OPEN, tf_item_open_at(dir, subpath, item));
+}
+
+
+int tf_stat(const char* path, tf_stat_t* st)
+{
+    if (path == nullptr || st == nullptr) {
+        return TF_ERR_PARAM;
+    }
+
+    tf_item_t item;
+    int       ret = tf_item_open(path, &item);
+    if (ret == 0) {
+        tf_item_stat(&item, st);
+    }
+    return ret;
+}
+
+
+int tf_statat(tf_dir_t* dir, const char* subpath, tf_stat_t* st)
+{
+    if (dir == nullptr || subpath == nullptr || st == nullptr) {
+        return TF_ERR_PARAM;
+    }
+
+    tf_item_t item;
+    int       ret = tf_item_openat(dir, subpath, &item);
+    if (ret == 0) {
+        tf_item_stat(&item, st);
+    }
+    return ret;
+}
+
+
+int tf_item_close(tf_item_t* item)
+{
+    if (item == nullptr) {
+        return TF_ERR_PARAM;
+    }
+    memset(item, 0, sizeof(tf_item_t));
+    return 0;
+}
+
+
+/**
+ * @brief read next item of a dir, see `tf_dir_read`
+ *
+ * @param dir
+ * @param item
+ * @return int 0-ok, positive-has end, TF_PENDING-read not done, other negtive-fail
+ */
+static int tf_dir_read_item(tf_dir_t* dir, tf_item_t* item)
+{
+    if (dir == nullptr || item == nullptr) {
+        return TF_ERR_PARAM;
+    }
+    if (!TF_MASK_MATCH(dir->attr, TF_ATTR_DIRECTORY)) {
+        return TF_ERR_PARAM;
+    }
+
+#if TF_EXFAT_SUPPORTED
+    if (dir->fs->type == TF_FS_EXFAT) {
+        return tf_exfat_dir_read(dir, item, nullptr);
+    }
+#endif
+
+    uint8_t* raw = nullptr;
+    int      ret = tf_dir_read_raw(dir, &raw, nullptr);
+    if (ret != 0) {
+        return ret;
+    }
+
+    tf_item_parse(dir->fs, raw, item);
+    return 0;
+}
+
+
+int tf_dir_read(tf_dir_t* dir, tf_item_t* item)
+{
+    return TF_PROF(TF_PROF_DIR_READ, tf_dir_read_item(dir, item));
+}
+
+
+/**
+ * @brief read next item matching a sfn pattern, the raw items are matched before parsed
+ *
+ * the exfat items have no sfn, their names are matched if they are 8.3
+ *
+ * @param dir
+ * @param pattern made by `tf_sfn_pattern`
+ * @param dirs the dirs are read even if not matched
+ * @param item result value
+ * @param matched result value, false for the dir not matched
+ * @return int 0-ok, positive-has end, TF_PENDING-read not done, other negtive-fail
+ */
+int tf_dir_read_match(tf_dir_t* dir, const char* pattern, bool dirs, tf_item_t* item, bool* matched)
+{
+    uint8_t* raw = nullptr;
+    int      ret;
+
+#if TF_EXFAT_SUPPORTED
+    if (dir->fs->type == TF_FS_EXFAT) {
+        char sfn[TF_SFN_LEN];
+        while ((ret = tf_exfat_dir_read(dir, item, nullptr)) == 0) {
+            *matched = (tf_name2sfn(item->name, sfn) == 0 && tf_sfn_match(pattern, (uint8_t*)sfn));
+            if (*matched || (dirs && TF_MASK_MATCH(item->attr, TF_ATTR_DIRECTORY))) {
+                return 0;
+            }
+        }
+        return ret;
+    }
+#endif
+
+    while ((ret = tf_dir_read_raw(dir, &raw, nullptr)) == 0) {
+        *matched = tf_sfn_match(pattern, raw);
+        if (*matched || (dirs && TF_MASK_MATCH(raw[11], TF_ATTR_DIRECTORY))) {   // DIR_Attr
+            tf_item_parse(dir->fs, raw, item);
+            return 0;
+        }
+    }
+    return ret;
+}
+
+
+int tf_file_read(tf_file_t* file, uint8_t* buffer, uint32_t size)
+{
+    if (file == nullptr || buffer == nullptr) {
+        return TF_ERR_PARAM;
+    }
+
+    tf_iovec_t iov = {.base = buffer, .len = size};
+    return tf_file_readv(file, &iov, 1);
+}
+
+
+/**
+ * @brief read file content into several buffers, see `tf_file_readv`
+ *
+ * @param file
+ * @param iov
+ * @param iovcnt
+ * @return int the data size really read, TF_PENDING-no data read for a pending disk read, other negtive-fail
+ */
+static int tf_file_read_iov(tf_file_t* file, const tf_iovec_t* iov, int iovcnt)
+{
+    if (file == nullptr || iov == nullptr || iovcnt < 0) {
+        return TF_ERR_PARAM;
+    }
+    if (TF_MASK_MATCH(file->attr, TF_ATTR_DIRECTORY)) {
+        return TF_ERR_PARAM;
+    }
+
+    tf_fs_t* fs            = file->fs;
+    uint32_t size_read     = 0;
+    uint32_t size_left     = file->size - file->cur_ofs;
+    uint32_t file_ofs_bak  = file->cur_ofs;
+    uint32_t file_clus_bak = file->cur_clus;
+
+    for (int i = 0; i < iovcnt && size_left > 0; i++) {
+        uint8_t* buffer = iov[i].base;
+        uint32_t size   = util_min2(iov[i].len, size_left);
+        uint32_t done   = 0;
+
+        while (done < size) {
+            uint32_t sec_id   = 0;
+            uint32_t clus_bak = file->cur_clus;   // moved if at the start of next cluster
+            int      ret      = tf_item_data_locate(file, &sec_id);
+            if (ret > 0) {   // no data to fetch
+                size_left = 0;
+                break;
+            }
+            if (ret == TF_PENDING) {   // keep the data read, go on here next time
+                file->cur_clus = clus_bak;
+                return (size_read + done > 0) ? (int)(size_read + done) : TF_PENDING;
+            }
+
+            uint32_t ofs = file->cur_ofs & TF_SEC_MASK(fs);
+            uint32_t readnow;
+
+            if (ofs == 0 && size - done >= TF_SEC_SIZE(fs)) {
+                // whole sectors, read to buffer directly, continue to the next cluster if it's adjacent
+                uint32_t sec_want = (size - done) >> TF_SEC_SHIFT(fs);
+                uint32_t sec_num  = util_min2(sec_want, TF_CLUS_SEC_NUM(fs) - ((sec_id - fs->dat_sec_ofs) &
+                                                                              (TF_CLUS_SEC_NUM(fs) - 1)));
+                uint32_t clus     = file->cur_clus;
+                while (sec_num < sec_want &&
+                       ((file->flags & TF_ITEM_NO_FAT_CHAIN) || tf_next_cluster(fs, clus) == clus + 1)) {
+                    clus++;
+                    sec_num = util_min2(sec_want, sec_num + TF_CLUS_SEC_NUM(fs));
+                }
+
+                ret            = tf_fs_disk_read_burst(fs, sec_id, sec_num, &buffer[done]);
+                file->cur_clus = clus;
+                readnow        = sec_num << TF_SEC_SHIFT(fs);
+            } else {
+                // part of sector, read through cache
+                ret     = tf_fs_disk_read(fs, sec_id, TF_CACHE_DATA);
+                readnow = util_min2(size - done, TF_SEC_SIZE(fs) - ofs);
+                if (ret == 0) {
+                    memcpy(&buffer[done], &fs->cache[ofs], readnow);
+                }
+            }
+
+            if (ret == TF_PENDING) {
+                file->cur_clus = clus_bak;
+                return (size_read + done > 0) ? (int)(size_read + done) : TF_PENDING;
+            }
+            if (ret != 0) {
+                file->cur_ofs  = file_ofs_bak;
+                file->cur_clus = file_clus_bak;
+                return TF_ERR_DISKACCESS;
+            }
+
+            file->cur_ofs += readnow;
+            done += readnow;
+        }
+
+        size_read += done;
+        size_left -= util_min2(done, size_left);
     }
 
     return size_read;
 }
+
+
+int tf_file_readv(tf_file_t* file, const tf_iovec_t* iov, int iovcnt)
+{
+    return TF_PROF(TF_PROF_FILE_READ, tf_file_read_iov(file, iov, iovcnt));
+}
+
+
+/**
+ * @brief borrow file content in cache, see `tf_file_read_ptr`
+ *
+ * @param file
+ * @param ptr
+ * @param max
+ * @return int the data size really borrowed, 0 at the end of file, TF_PENDING-disk read not done, other negtive-fail
+ */
+static int tf_file_borrow(tf_file_t* file, const uint8_t** ptr, uint32_t max)
+{
+    if (file == nullptr || ptr == nullptr) {
+        return TF_ERR_PARAM;
+    }
+    if (TF_MASK_MATCH(file->attr, TF_ATTR_DIRECTORY)) {
+        return TF_ERR_PARAM;
+    }
+
+    tf_fs_t* fs = file->fs;
+    if (fs->pinned_buf != nullptr) {   // one borrowed sector a volume
+        return TF_ERR_CACHE_PINNED;
+    }
+
+    uint32_t size = util_min2(max, file->size - file->cur_ofs);
+    if (size == 0) {
+        return 0;
+    }
+
+    uint32_t clus_bak = file->cur_clus;   // moved if at the start of next cluster
+    int      ret      = tf_item_data_fetch(file);
+    if (ret < 0) {
+        file->cur_clus = clus_bak;
+        return (ret == TF_PENDING) ? TF_PENDING : TF_ERR_DISKACCESS;
+    }
+    if (ret > 0) {   // no data to fetch
+        return 0;
+    }
+
+    // borrow the data in current sector
+    uint32_t ofs     = file->cur_ofs & TF_SEC_MASK(fs);
+    uint32_t readnow = util_min2(size, TF_SEC_SIZE(fs) - ofs);
+
+    *ptr                   = &fs->cache[ofs];
+    fs->pinned_buf         = fs->cache_buf;
+    fs->pinned_buf->pinned = true;
+    file->cur_ofs += readnow;
+    return readnow;
+}
+
+
+int tf_file_read_ptr(tf_file_t* file, const uint8_t** ptr, uint32_t max)
+{
+    return TF_PROF(TF_PROF_FILE_READ, tf_file_borrow(file, ptr, max));
+}
+
+
+int tf_file_read_release(tf_file_t* file)
+{
+    if (file == nullptr || file->fs == nullptr) {
+        return TF_ERR_PARAM;
+    }
+    tf_fs_t*        fs  = file->fs;
+    tf_cache_buf_t* buf = fs->pinned_buf;
+    if (buf != nullptr && buf->fs == fs) {   // not dropped
+        buf->pinned = false;
+    }
+    fs->pinned_buf = nullptr;
+    return 0;
+}
+
+
+/**
+ * @brief mark the lfn items of a dir item deleted, they are just before the sfn item
+ *
+ * the lfn items in the previous cluster are not reached, they are left as orphans, which are ignored for the
+ * checksum mismatch
+ *
+ * @param item
+ * @return int 0-ok, other-fail
+ */
+static int tf_item_lfn_delete(tf_item_t* item)
+{
+    tf_fs_t* fs       = item->fs;
+    uint32_t sec_id   = item->raw_sec;
+    uint16_t ofs      = item->raw_ofs;
+    uint8_t  checksum = tf_sfn_checksum(item->raw);
+    uint8_t  order    = 1;   // order of the next lfn item wanted
+    bool     dirty    = false;
+
+    while (true) {
+        if (ofs == 0) {   // go to the previous sector, in the same cluster only
+            if (dirty && tf_fs_disk_write(fs, sec_id, fs->cache) != 0) {
+                return TF_ERR_DISKACCESS;
+            }
+            if (((sec_id - fs->dat_sec_ofs) & (TF_CLUS_SEC_NUM(fs) - 1)) == 0) {
+                return 0;
+            }
+            sec_id--;
+            ofs   = TF_SEC_SIZE(fs);
+            dirty = false;
+        }
+        if (tf_fs_disk_read(fs, sec_id, TF_CACHE_META) != 0) {
+            return TF_ERR_DISKACCESS;
+        }
+
+        ofs -= TF_DIRITEM_SIZE;
+        uint8_t* raw = fs->cache + ofs;
+        if (raw[11] != TF_ATTR_LFN || raw[13] != checksum || (raw[0] & 0x3F) != order) {   // LDIR_Ord, LDIR_Chksum
+            break;
+        }
+
+        bool last = (raw[0] & 0x40) != 0;   // LAST_LONG_ENTRY
+        raw[0]    = TF_ATTR_DELETED;
+        dirty     = true;
+        order++;
+        if (last) {
+            break;
+        }
+    }
+    return dirty ? tf_fs_disk_write(fs, sec_id, fs->cache) : 0;
+}
+
+
+/**
+ * @brief delete a file, see `tf_file_delete`
+ *
+ * @param path
+ * @return int 0-ok, other-fail
+ */
+static int tf_item_delete(const char* path)
+{
+    tf_file_t file;
+    int       ret = tf_item_open(path, &file);
+    if (ret != 0) {
+        return ret;
+    }
+    if (TF_MASK_MATCH(file.attr, TF_ATTR_DIRECTORY) || file.raw_sec == TF_INVALID_SECTOR_ID) {
+        return TF_ERR_PARAM;
+    }
+
+    tf_fs_t* fs = file.fs;
+    if (fs->type != TF_FS_FAT32) {   // exfat is read only
+        return TF_ERR_NOT_SUPPORTED;
+    }
+
+    // unlink first, a power loss after it leaves lost clusters only
+    ret = tf_item_lfn_delete(&file);
+    if (ret == 0) {
+        file.raw[0] = TF_ATTR_DELETED;
+        ret         = tf_item_raw_update(&file);
+    }
+    if (ret == 0 && file.first_clus >= 2) {
+        ret = tf_fat_free_chain(fs, file.first_clus);
+    }
+    if (ret == 0) {
+        ret = tf_fs_disk_flush(fs);
+    }
+    return (ret == 0 || ret == TF_ERR_NOT_SUPPORTED) ? ret : TF_ERR_DISKACCESS;
+}
+
+
+int tf_file_delete(const char* path)
+{
+    return TF_PROF(TF_PROF_FILE_DELETE, TF_IO_WAIT(tf_item_delete(path)));
+}
+
+
+/**
+ * @brief create an empty file in the first free item of its dir, the dir is grown by a zeroed cluster if it is full
+ *
+ * @param path absolute path, the name should be 8.3, the lfn items are not written
+ * @param item the new file, result value
+ * @return int 0-ok, TF_ERR_LFN_NOT_SUPPORTED-name not 8.3, TF_ERR_NOT_SUPPORTED-exfat volume, other-fail
+ */
+int tf_item_create(const char* path, tf_item_t* item)
+{
+    static char parent[TF_PATH_LEN_MAX];
+    uint8_t     raw[TF_DIRITEM_SIZE] = {0};
+    const char* name                 = strrchr(path, '/');
+
+    if (name == nullptr || name[1] == '\0' || name - path + 1 >= TF_PATH_LEN_MAX) {
+        return TF_ERR_PATH;
+    }
+    uint16_t len = name - path;
+    if (len == 0 || path[len - 1] == ':') {   // keep '/' of root dir
+        len++;
+    }
+    memcpy(parent, path, len);
+    parent[len] = '\0';
+    name++;
+
+    char sfn[TF_SFN_LEN];
+    if (tf_name2sfn(name, sfn) != 0 || strchr(name, ' ') != nullptr || strlen(sfn) != 11) {   // not 8.3
+        return TF_ERR_LFN_NOT_SUPPORTED;
+    }
+    memcpy(raw, sfn, 11);          // DIR_Name
+    raw[11] = TF_ATTR_ARCHIVE;   // DIR_Attr, no cluster, size 0
+    tf_item_stamp(raw, true);
+
+    tf_dir_t dir;
+    int      ret = tf_item_open(parent, &dir);
+    if (ret != 0) {
+        return ret;
+    }
+    if (!TF_MASK_MATCH(dir.attr, TF_ATTR_DIRECTORY)) {
+        return TF_ERR_PATH;
+    }
+
+    tf_fs_t* fs = dir.fs;
+    if (fs->type != TF_FS_FAT32) {   // exfat is read only
+        return TF_ERR_NOT_SUPPORTED;
+    }
+
+    // the first empty or deleted item
+    uint8_t* p = nullptr;
+    while ((ret = tf_item_data_fetch(&dir)) == 0) {
+        p = fs->cache + (dir.cur_ofs & TF_SEC_MASK(fs));
+        if (p[0] == TF_ATTR_EMPTY || p[0] == TF_ATTR_DELETED) {
+            break;
+        }
+        dir.cur_ofs += TF_DIRITEM_SIZE;
+    }
+    if (ret < 0) {
+        return TF_ERR_DISKACCESS;
+    }
+    if (ret > 0) {   // dir full, a zeroed cluster is linked
+        uint32_t last = dir.cur_clus;
+        uint32_t first;
+        ret = tf_fat_alloc(fs, &last, 1, &first);
+        if (ret != 0) {
+            return ret;
+        }
+        uint32_t sec_id = TF_CLUS2SEC(fs, first);
+        if (tf_fs_disk_read(fs, sec_id, TF_CACHE_META) != 0) {
+            return TF_ERR_DISKACCESS;
+        }
+        memset(fs->cache, 0, TF_SEC_SIZE(fs));
+        for (uint32_t i = TF_CLUS_SEC_NUM(fs); i > 0; i--) {   // the first sector is written last, kept in cache
+            if (tf_fs_disk_write(fs, sec_id + i - 1, fs->cache) != 0) {
+                return TF_ERR_DISKACCESS;
+            }
+        }
+        if (tf_fat_flush(fs) != 0) {
+            return TF_ERR_DISKACCESS;
+        }
+        p = fs->cache;
+    }
+
+    memcpy(p, raw, TF_DIRITEM_SIZE);
+    if (tf_fs_disk_write(fs, fs->cache_sec_id, fs->cache) != 0) {
+        return TF_ERR_DISKACCESS;
+    }
+#if TF_LFN_SUPPORTTED
+    lfn_name[0] = '\0';
+#endif
+    tf_item_parse(fs, p, item);
+    return tf_fs_disk_flush(fs) == 0 ? 0 : TF_ERR_DISKACCESS;
+}
+
+
+/**
+ * @brief shrink a file, see `tf_file_truncate`
+ *
+ * @param file
+ * @param size
+ * @return int 0-ok, other-fail
+ */
+static int tf_item_shrink(tf_file_t* file, uint32_t size)
+{
+    if (file == nullptr || file->fs == nullptr) {
+        return TF_ERR_PARAM;
+    }
+    if (TF_MASK_MATCH(file->attr, TF_ATTR_DIRECTORY) || size > file->size) {   // no data to grow with
+        return TF_ERR_PARAM;
+    }
+
+    tf_fs_t* fs = file->fs;
+    if (fs->type != TF_FS_FAT32) {   // exfat is read only
+        return TF_ERR_NOT_SUPPORTED;
+    }
+    if (size == file->size) {
+        return 0;
+    }
+
+    // the last cluster kept, and the first one freed
+    uint32_t keep_num = (size >> TF_CLUS_SHIFT(fs)) + ((size & TF_CLUS_MASK(fs)) != 0);
+    uint32_t last     = file->first_clus;
+    uint32_t tail     = file->first_clus;
+    for (uint32_t i = 0; i < keep_num; i++) {
+        last = tail;
+        tail = tf_next_cluster(fs, last);
+        if (tail == TF_INVALID_CLUSTER_ID) {   // FAT read fail, not an end of chain
+            return TF_ERR_DISKACCESS;
+        }
+        if (!TF_CLUSTER_ID_VALID(tail) && i + 1 < keep_num) {   // chain shorter than size
+            return TF_ERR_DISKACCESS;
+        }
+    }
+
+    // shrink the dir item first, a power loss after it leaves a chain longer than the size only
+    util_uint2bytes_le(file->raw + 28, size, 4);   // DIR_FileSize
+    if (keep_num == 0) {
+        util_uint2bytes_le(file->raw + 20, 0, 2);   // DIR_FstClusHI
+        util_uint2bytes_le(file->raw + 26, 0, 2);   // DIR_FstClusLO
+    }
+    tf_item_stamp(file->raw, false);
+    int ret = tf_item_raw_update(file);
+    if (ret != 0) {
+        return (ret == TF_ERR_NOT_SUPPORTED) ? ret : TF_ERR_DISKACCESS;
+    }
+
+    file->size = size;
+    if (keep_num == 0) {
+        file->first_clus = 0;
+    }
+    if (file->cur_ofs > size) {   // cur_clus is the cluster of the last byte read
+        file->cur_ofs  = size;
+        file->cur_clus = (keep_num == 0) ? 0 : last;
+    }
+    file->hint_clus = file->first_clus;
+    file->hint_ofs  = 0;
+
+    if (keep_num > 0 && TF_CLUSTER_ID_VALID(tail) && tail >= 2) {
+        ret = tf_fat_set(fs, last, TF_FAT_EOC);
+    }
+    if (ret == 0 && TF_CLUSTER_ID_VALID(tail) && tail >= 2) {
+        ret = tf_fat_free_chain(fs, tail);
+    }
+    if (ret == 0) {
+        ret = tf_fs_disk_flush(fs);
+    }
+    return ret == 0 ? 0 : TF_ERR_DISKACCESS;
+}
+
+
+int tf_file_truncate(tf_file_t* file, uint32_t size)
+{
+    return TF_PROF(TF_PROF_FILE_TRUNCATE, TF_IO_WAIT(tf_item_shrink(file, size)));
+}
+
+
+int tf_item_get_times(const tf_item_t* item, tf_time_t* write_time, tf_time_t* create_time)
+{
+    if (item == nullptr) {
+        return TF_ERR_PARAM;
+    }
+    if (item->raw[0] == 0) {   // root dir, no dir item
+        return TF_ERR_PARAM;
+    }
+
+    uint8_t* raw = (uint8_t*)item->raw;
+#if TF_EXFAT_SUPPORTED
+    if (item->fs->type == TF_FS_EXFAT) {   // timestamp: date << 16 | time
+        uint32_t ts;
+        if (write_time != nullptr) {
+            ts = util_bytes2uint_le(raw + 12, 4);   // LastModifiedTimestamp
+            tf_time_decode(ts >> 16, ts & 0xFFFF, write_time);
+        }
+        if (create_time != nullptr) {
+            ts = util_bytes2uint_le(raw + 8, 4);   // CreateTimestamp
+            tf_time_decode(ts >> 16, ts & 0xFFFF, create_time);
+        }
+        return 0;
+    }
+#endif
+    if (write_time != nullptr) {
+        tf_time_decode(util_bytes2uint_le(raw + 24, 2), util_bytes2uint_le(raw + 22, 2),
+                       write_time);   // DIR_WrtDate, DIR_WrtTime
+    }
+    if (create_time != nullptr) {
+        tf_time_decode(util_bytes2uint_le(raw + 16, 2), util_bytes2uint_le(raw + 14, 2),
+                       create_time);   // DIR_CrtDate, DIR_CrtTime
+    }
+    return 0;
+}
+
+
+int tf_item_get_name(const tf_item_t* item, char* name)
+{
+    if (item == nullptr || name == nullptr) {
+        return TF_ERR_PARAM;
+    }
+#if TF_LONG_NAME_SUPPORTED
+    if (item->name[0] != '\0') {
+        strcpy(name, item->name);
+        return 0;
+    }
+#endif
+    if (item->raw_sec == TF_INVALID_SECTOR_ID) {   // root dir, sfn is the label
+        strcpy(name, item->sfn);
+        return 0;
+    }
+    return tf_sfn2name(item->sfn, name);
+}
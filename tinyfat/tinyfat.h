@@ -13,6 +13,13 @@
 #define TF_ERR_LFN_NOT_SUPPORTED -9
 #define TF_ERR_SECTORSIZE        -12
 #define TF_ERR_DISKACCESS        -13
+#define TF_ERR_CACHE_PINNED      -14
+#define TF_ERR_NO_SPACE          -15
+#define TF_ERR_NOT_SUPPORTED     -16
+#define TF_PENDING               -17   // disk read not done yet, call again later to go on
+#define TF_ERR_NO_MEM            -18
+
+#define TF_DIRITEM_SIZE          32   // size of a raw directory item
 
 // item attr
 #define TF_ATTR_READ_ONLY 0x01
@@ -22,6 +29,13 @@
 #define TF_ATTR_DIRECTORY 0x10
 #define TF_ATTR_ARCHIVE   0x20
 
+#define TF_LONG_NAME_SUPPORTED (TF_LFN_SUPPORTTED || TF_EXFAT_SUPPORTED)   // long name kept in item
+
+// item flags
+#define TF_ITEM_NO_FAT_CHAIN 0x01   // exfat: clusters are continuous, FAT is not used
+#define TF_ITEM_PENDING      0x02   // open stopped by a pending read, the item is the dir being searched
+#define TF_ITEM_WRAPPED      0x04   // pending search has wrapped around to the start of dir
+
 #define tf_dir_open   tf_item_open
 #define tf_dir_close  tf_item_close
 #define tf_file_open  tf_item_open
@@ -39,29 +53,234 @@ typedef struct {
 } tf_time_t;
 
 typedef struct {
-    uint8_t   attr;              // bitmap of TF_ATTR_*
-    char      sfn[TF_SFN_LEN];   //
-    uint32_t  size;              // size of file
-    uint32_t  first_clus;        // first cluster id (start at 2)
-    uint32_t  cur_clus;          //
-    uint32_t  cur_ofs;           // current byte offset
-    tf_time_t write_time;
-    tf_time_t create_time;
-    tf_fs_t*  fs;
+    uint8_t     attr;                    // bitmap of TF_ATTR_*
+    uint8_t     flags;                   // bitmap of TF_ITEM_*
+    char        sfn[TF_SFN_LEN];         // empty for exfat item
+#if TF_LONG_NAME_SUPPORTED
+    char        name[TF_NAME_LEN_MAX];   // long name (exfat: name), utf-8, cut if too long, empty if none
+#endif
+    uint32_t    size;                    // size of file, exfat dir: size of dir too
+    uint32_t    first_clus;              // first cluster id (start at 2)
+    uint32_t    cur_clus;                //
+    uint32_t    cur_ofs;                 // current byte offset
+    uint32_t    hint_clus;               // dir only: cluster where the last search stopped
+    uint32_t    hint_ofs;                // dir only: byte offset where the last search stopped, next search starts here
+    uint8_t     raw[TF_DIRITEM_SIZE];    // raw dir item (exfat: the file entry), decoded on demand
+    uint32_t    raw_sec;                 // sector id of the raw dir item
+    uint16_t    raw_ofs;                 // byte offset of the raw dir item in the sector
+    const char* pend_path;               // TF_ITEM_PENDING: the subpath being opened
+    uint16_t    pend_ofs;                // TF_ITEM_PENDING: offset of the part being searched in pend_path
+    tf_fs_t*    fs;
 } tf_item_t;
 
 
 #define tf_dir_t  tf_item_t
 #define tf_file_t tf_item_t
 
+typedef struct {
+    uint8_t* base;   // buffer
+    uint32_t len;    // buffer size
+} tf_iovec_t;
+
+typedef struct {
+    uint8_t   attr;                    // bitmap of TF_ATTR_*
+    char      sfn[TF_SFN_LEN];         //
+    char      name[TF_NAME_LEN_MAX];   // name of item, see `tf_item_get_name`
+    uint32_t  size;                    // size of file
+    uint32_t  first_clus;              // first cluster id (start at 2)
+    tf_time_t write_time;              // zero for root dir
+    tf_time_t create_time;             // zero for root dir
+} tf_stat_t;
+
+typedef struct {
+    uint32_t clus_size;     // bytes of a cluster
+    uint32_t total_clus;    // cluster count of volume
+    uint32_t free_clus;     // free cluster count
+    uint64_t total_bytes;   //
+    uint64_t free_bytes;    //
+} tf_statfs_t;
+
+/**
+ * @brief block device ops of a volume, given to `tf_mount`
+ *
+ * `read` is a must, the others could be nullptr: multi-sector i/o falls back to sector by sector, no `write`
+ * means read only, no `flush` or `discard` means nothing to do
+ *
+ * non-blocking: `read` and `read_multi` could return TF_PENDING if the data is not ready, the same sectors are
+ * asked again later, maybe to another buffer; `tf_item_open`, `tf_item_openat`, `tf_dir_read`, `tf_file_read`,
+ * `tf_file_readv` and `tf_file_read_ptr` return TF_PENDING then, with the progress kept in the handle, and go on
+ * when called again; the other apis ask again until the read is done
+ *
+ * warm start (FAT32): with `snap_read` and `snap_write`, the items opened by path are kept in a snapshot with the
+ * free count, the files in one extent are marked so they are read without FAT; it is saved at unmount, and loaded
+ * at mount if the volume serial and FSInfo are the same as saved; each item is loaded if its dir item and the FAT
+ * sectors of its extent are the same on disk, then its path is opened without a dir lookup; the snapshot kept is
+ * voided before the first write of a mount, so a power loss leaves no stale one
+ */
+typedef struct {
+    int (*read)(void* ctx, uint32_t sec_id, uint16_t sec_size, uint8_t* data);
+    int (*read_multi)(void* ctx, uint32_t sec_id, uint32_t count, uint16_t sec_size, uint8_t* data);
+    int (*write)(void* ctx, uint32_t sec_id, uint16_t sec_size, const uint8_t* data);
+    int (*write_multi)(void* ctx, uint32_t sec_id, uint32_t count, uint16_t sec_size, const uint8_t* data);
+    int (*flush)(void* ctx);                                            // make the written data durable
+    int (*discard)(void* ctx, uint32_t sec_id, uint32_t count);         // sectors not used any more, like TRIM/ERASE
+    uint32_t io_align;                                                  // multi-sector i/o alignment in sectors, 0-any
+    uint32_t io_size;                                                   // max sector count of multi-sector i/o, 0-any
+    void*    ctx;                                                       // user context, given to all ops
+    int (*snap_read)(void* ctx, uint8_t* data, uint32_t size);          // load the snapshot, bytes read, <0-none
+    int (*snap_write)(void* ctx, const uint8_t* data, uint32_t size);   // keep the snapshot, such as in NVRAM, 0-ok
+} tf_disk_ops_t;
+
+/**
+ * @brief RAM disk, the sectors are a memory area, see `tf_ramdisk_open`
+ */
+typedef struct {
+    uint8_t*      data;        // from user
+    uint32_t      size;        // bytes of data
+    bool          read_only;   // such as a mapped base image, no `write` in ops
+    tf_disk_ops_t ops;         // given to `tf_mount`
+} tf_ramdisk_t;
+
+/**
+ * @brief copy-on-write overlay of a device, the sectors written are kept in a delta pool, see `tf_overlay_open`
+ */
+typedef struct {
+    const tf_disk_ops_t* base;        // read only, such as a RAM disk on a mapped image, shared by overlays
+    uint8_t*             pool;        // delta sectors, from user
+    uint32_t             slot_num;    // sectors the pool holds
+    uint32_t             used_num;    // sectors in pool
+    uint16_t             sec_size;    //
+    uint32_t*            index;       // open addressing hash, sector id + 1 then slot, from heap, 0-empty
+    uint32_t             index_cap;   // entries of index, pow of 2
+    tf_disk_ops_t        ops;         // given to `tf_mount`
+} tf_overlay_t;
+
+/**
+ * @brief append buffer of a file, records are gathered in it and written as whole sectors, see `tf_append_open`
+ */
+typedef struct {
+    tf_file_t* file;        // file appended to, its size is the one in dir item
+    uint8_t*   buffer;      // from user, whole sectors
+    uint32_t   buf_size;    // bytes of buffer
+    uint32_t   buf_len;     // bytes buffered, the tail sector of file is loaded at first
+    uint32_t   base;        // file offset of buffer, sector aligned
+    uint32_t   clus;        // cluster of base, 0 if not allocated yet
+    uint32_t   last_clus;   // last cluster of the file chain, 0 if none
+    uint32_t   clus_num;    // cluster count of the file chain
+    uint32_t   max_age;     // synced if the first byte not synced is older, 0-no time threshold
+    uint32_t   stamp;       // time of the first byte not synced
+} tf_append_t;
+
+#define TF_FRAG_HIST_NUM 8   // run length histogram size of frag report
+
+typedef struct {
+    char     path[TF_PATH_LEN_MAX];   // truncated if too long
+    uint32_t clus_num;                // cluster count of file
+    uint32_t extent_num;              // count of continuous cluster runs
+} tf_frag_file_t;
+
+typedef struct {
+    uint32_t       file_num;                     // files scanned
+    uint32_t       frag_file_num;                // files with more than one extent
+    uint32_t       clus_num;                     // clusters of all files
+    uint32_t       extent_num;                   // extents of all files
+    uint32_t       run_hist[TF_FRAG_HIST_NUM];   // extent count by length, [i]: 2^i ~ 2^(i+1)-1 clusters, last: more
+    tf_frag_file_t worst[TF_FRAG_WORST_NUM];     // files with most extents, most first
+} tf_frag_report_t;
+
+#define TF_CHECK_REPAIR 0x01   // check flag: fix the problems found, see `tf_check`
+
+typedef struct {
+    uint32_t file_num;           // files reached from root
+    uint32_t dir_num;            // dirs reached from root, root not counted
+    uint32_t used_clus_num;      // clusters in the chains reached
+    uint32_t free_clus_num;      // free clusters in FAT, lost ones freed counted too
+    uint32_t lost_clus_num;      // used clusters in no chain reached
+    uint32_t cross_link_num;     // chains running into the clusters of another chain
+    uint32_t bad_chain_num;      // chains running into a free, bad or out of range cluster
+    uint32_t bad_size_num;       // files whose size does not fit the chain length
+    uint32_t fat_diff_sec_num;   // sectors of the other FATs differing from the first one
+    bool     free_count_bad;     // free count of FSInfo is wrong
+    uint32_t repaired_num;       // problems fixed, TF_CHECK_REPAIR only
+} tf_check_report_t;
+
+#define TF_WALK_SKIP        1      // walk callback: do not go into this dir, the same as 0 for a file
+#define TF_WALK_DIRS_ONLY   0x01   // walk flag: dirs are given to callback, files are not
+#define TF_WALK_SKIP_HIDDEN 0x02   // walk flag: hidden and system items are ignored, so are the items under them
+#define TF_FIND_RECURSIVE   0x04   // find flag: the sub dirs are searched too, with the walk flags
+
+/**
+ * @brief called for each item found by `tf_walk`
+ *
+ * @param ctx user context
+ * @param path path of the item, cut if longer than TF_WALK_PATH_LEN_MAX - 1
+ * @param item the found item, could be opened further, such as read
+ * @param depth 1 for the items in the walked dir
+ * @return int 0-go on, TF_WALK_SKIP-do not go into this dir, go on for a file, other-stop the walk, returned by
+ *             `tf_walk`
+ */
+typedef int (*tf_walk_cb_t)(void* ctx, const char* path, tf_item_t* item, uint16_t depth);
+
+// disk access trace: a head, then records, all little endian
+#define TF_TRACE_MAGIC    0x52544654   // "TFTR", first 4 bytes of head
+#define TF_TRACE_VERSION  1            //
+#define TF_TRACE_HEAD_LEN 8            // magic 4, version 2, record size 2
+#define TF_TRACE_REC_LEN  12           // time 4, sector id 4, sector count 2, device 1, op 1
+#define TF_TRACE_META     0            // op: FAT, dir or fs sector read through the cache pool
+#define TF_TRACE_DATA     1            // op: file data sector read through the cache pool
+#define TF_TRACE_DIRECT   2            // op: sectors read to user buffer directly, the cache is bypassed
+#define TF_TRACE_WRITE    3            // op: sectors written, the cached ones are updated
+
 /**
- * @brief mount a device to file system
+ * @brief where the trace goes, such as a host file, or a file of another volume not traced
+ */
+typedef struct {
+    int (*write)(void* ctx, const uint8_t* data, uint32_t size);   // append trace bytes, 0-ok
+    uint32_t (*clock)(void* ctx);                                   // timestamp, such as us, nullptr-record index
+    void* ctx;                                                      // user context, given to all callbacks
+} tf_trace_sink_t;
+
+// latency profile points, the time of an api is from entry to return, the disk ops in it included
+#define TF_PROF_MOUNT         0    // tf_mount
+#define TF_PROF_UNMOUNT       1    // tf_unmount
+#define TF_PROF_STATFS        2    // tf_statfs
+#define TF_PROF_ITEM_OPEN     3    // tf_item_open, tf_item_openat, and the stat apis by them
+#define TF_PROF_DIR_READ      4    // tf_dir_read, one item a call
+#define TF_PROF_FILE_READ     5    // tf_file_read, tf_file_readv, tf_file_read_ptr
+#define TF_PROF_FILE_DELETE   6    // tf_file_delete
+#define TF_PROF_FILE_TRUNCATE 7    // tf_file_truncate
+#define TF_PROF_APPEND        8    // tf_append_open, tf_append_write, tf_append_poll, tf_append_sync
+#define TF_PROF_COPY          9    // tf_copy
+#define TF_PROF_WALK          10   // tf_walk, tf_find
+#define TF_PROF_CHECK         11   // tf_check
+#define TF_PROF_FRAG_SCAN     12   // tf_frag_scan, tf_file_extents
+#define TF_PROF_DEFRAG        13   // tf_defrag_file
+#define TF_PROF_DISK_READ     14   // device read, until the data is ready if pending in an operation not resumable
+#define TF_PROF_DISK_WRITE    15   // device write, a call of `write` or `write_multi`
+#define TF_PROF_DISK_FLUSH    16   // device flush
+#define TF_PROF_DISK_DISCARD  17   // device discard
+#define TF_PROF_POINT_NUM     18   //
+
+typedef struct {
+    uint32_t count;                    // calls
+    uint32_t max;                      // longest time of a call, in clock ticks
+    uint64_t total;                    // time of all calls
+    uint32_t hist[TF_PROF_HIST_NUM];   // call count by time, [i]: 2^i ~ 2^(i+1)-1 ticks, [0] with 0, last: more
+} tf_prof_point_t;
+
+typedef struct {
+    tf_prof_point_t point[TF_PROF_POINT_NUM];   // by TF_PROF_*
+} tf_prof_report_t;
+
+/**
+ * @brief mount a device to file system, FAT32 or exFAT (read only)
  *
  * @param device device id
  * @param label should be a printable char
+ * @param ops block device ops, should be kept until unmount
  * @return int 0-ok, other-fail
  */
-int tf_mount(int device, char label);
+int tf_mount(int device, char label, const tf_disk_ops_t* ops);
 
 /**
  * @brief unmount device
@@ -71,15 +290,132 @@ int tf_mount(int device, char label);
  */
 int tf_unmount(int device);
 
+/**
+ * @brief set the clock the dir items written are stamped by, such as a RTC: the write time of the files appended
+ *        or truncated, and the create time of the new files; without it the times are left as they are, zero for
+ *        the new files
+ *
+ * @param now gives the local time, returns 0 if the time is known; nullptr-no clock
+ * @param ctx user context, given to now
+ * @return int 0-ok, other-fail
+ */
+int tf_clock_set(int (*now)(void* ctx, tf_time_t* time), void* ctx);
+
+/**
+ * @brief set the share of a volume in the cache pool, which is shared by all volumes
+ *
+ * when a buffer is needed, the least recently used one of the volumes using more than their share is reused first
+ *
+ * @param device device id
+ * @param weight share is `TF_CACHE_POOL_NUM * weight / weight sum of all volumes`, 1 by default, 0-no share, its
+ *               buffers are always reused first
+ * @return int 0-ok, other-fail
+ */
+int tf_cache_set_weight(int device, uint8_t weight);
+
+#if TF_TRACE_SUPPORTED
+/**
+ * @brief start recording the disk accesses of all volumes, the cache hits included, so the trace could be replayed
+ *        with other cache configurations
+ *
+ * @param sink should be kept until `tf_trace_stop`, the accesses made by sink itself are not recorded
+ * @return int 0-ok, other-fail
+ */
+int tf_trace_start(const tf_trace_sink_t* sink);
+
+/**
+ * @brief stop recording, the buffered records are given to the sink
+ *
+ * @return int 0-ok, other-fail
+ */
+int tf_trace_stop(void);
+#endif
+
+#if TF_PROF_SUPPORTED
+/**
+ * @brief start profiling the apis and the disk ops of all volumes, the histograms are cleared
+ *
+ * @param clock cycle counter or timestamp source, could wrap around, the calls longer than a round are not right
+ * @param ctx user context, given to clock
+ * @return int 0-ok, other-fail
+ */
+int tf_prof_start(uint32_t (*clock)(void* ctx), void* ctx);
+
+/**
+ * @brief stop profiling, the histograms are kept for `tf_prof_get`
+ *
+ * @return int 0-ok, other-fail
+ */
+int tf_prof_stop(void);
+
+/**
+ * @brief get the histograms collected, when profiling or after stopped
+ *
+ * @param report result value
+ * @return int 0-ok, other-fail
+ */
+int tf_prof_get(tf_prof_report_t* report);
+
+/**
+ * @brief print a report, a line for each point called: count, average, max, and the non-empty buckets
+ *
+ * @param report
+ */
+void tf_prof_print(const tf_prof_report_t* report);
+#endif
+
+/**
+ * @brief get space info of a volume
+ *
+ * FSInfo free count is used if it is valid, otherwise the FAT is scanned once and the result is kept
+ *
+ * @param path any absolute path in the volume, like "/" or "x:/"
+ * @param st the space info, result value
+ * @return int 0-ok, other-fail
+ */
+int tf_statfs(const char* path, tf_statfs_t* st);
+
 /**
  * @brief open a file or dir
  *
  * @param path absolute path, like "/xxx" or "x:/xxx"
- * @param item the file or dir at the path, result value
- * @return int 0-ok, other-fail
+ * @param item the file or dir at the path, result value; if TF_PENDING, the search state, call again with the same
+ *             path and item to go on
+ * @return int 0-ok, TF_PENDING-disk read not done, other-fail
  */
 int tf_item_open(const char* path, tf_item_t* item);
 
+/**
+ * @brief open a file or dir relative to an opened dir, the ancestors of dir are not searched again
+ *
+ * @param dir the opened dir which subpath starts from, it remembers where the item was found, so opening the
+ *            items in the order they are stored scans each dir item only once
+ * @param subpath relative path, like "xxx/xxx"; if absolute, dir is ignored
+ * @param item the file or dir at the path, result value, could be the same as dir; if TF_PENDING, the search
+ *             state, call again with the same subpath and item to go on
+ * @return int 0-ok, TF_PENDING-disk read not done, other-fail
+ */
+int tf_item_openat(tf_dir_t* dir, const char* subpath, tf_item_t* item);
+
+/**
+ * @brief get info of a file or dir, without opening it
+ *
+ * @param path absolute path, like "/xxx" or "x:/xxx"
+ * @param st the info of the item, result value
+ * @return int 0-ok, other-fail
+ */
+int tf_stat(const char* path, tf_stat_t* st);
+
+/**
+ * @brief get info of a file or dir relative to an opened dir
+ *
+ * @param dir the opened dir which subpath starts from
+ * @param subpath relative path, like "xxx/xxx"; if absolute, dir is ignored
+ * @param st the info of the item, result value
+ * @return int 0-ok, other-fail
+ */
+int tf_statat(tf_dir_t* dir, const char* subpath, tf_stat_t* st);
+
 /**
  * @brief close a file or dir
  *
@@ -93,7 +429,7 @@ int tf_item_close(tf_item_t* item);
  *
  * @param dir should be dir really
  * @param item the item read from the dir, result value
- * @return int 0-ok, positive-has end, negtive-fail
+ * @return int 0-ok, positive-has end, TF_PENDING-disk read not done, the dir is not moved, other negtive-fail
  */
 int tf_dir_read(tf_dir_t* dir, tf_item_t* item);
 
@@ -103,20 +439,262 @@ int tf_dir_read(tf_dir_t* dir, tf_item_t* item);
  * @param file should be really file
  * @param buffer should be large enough to store the data you want
  * @param size the data size wanted
- * @return int the data size really read
+ * @return int the data size really read, less than wanted if a disk read is pending after some data read,
+ *             TF_PENDING-no data read for a pending disk read, other negtive-fail
  */
 int tf_file_read(tf_file_t* file, uint8_t* buffer, uint32_t size);
 
 /**
- * @brief read a sector from disk, CALLOUT
+ * @brief read file content into several buffers in order, once read, the file ptr will move
  *
- * @param device device id
- * @param sec_id sector id
- * @param sec_size sector size
- * @param data data buffer
+ * the file is walked only once, whole sectors are read to the buffers directly without the cache
+ *
+ * @param file should be really file
+ * @param iov buffers, each one is filled up before the next one
+ * @param iovcnt count of iov
+ * @return int the data size really read, TF_PENDING-no data read for a pending disk read, other negtive-fail
+ */
+int tf_file_readv(tf_file_t* file, const tf_iovec_t* iov, int iovcnt);
+
+/**
+ * @brief borrow file content from the fs cache without copying it, once read, the file ptr will move
+ *
+ * the data stays in a buffer of the cache pool, which is pinned and not reused until `tf_file_read_release` is
+ * called; only one sector of a volume could be borrowed at a time
+ *
+ * @param file should be really file
+ * @param ptr points to the data in cache, result value
+ * @param max the data size wanted at most, the size returned may be less, never crosses a sector
+ * @return int the data size really borrowed, 0 at the end of file, TF_PENDING-disk read not done, other
+ *             negtive-fail
+ */
+int tf_file_read_ptr(tf_file_t* file, const uint8_t** ptr, uint32_t max);
+
+/**
+ * @brief give back the data borrowed by `tf_file_read_ptr`, ptr should not be used any more
+ *
+ * @param file
+ * @return int 0-ok, other-fail
+ */
+int tf_file_read_release(tf_file_t* file);
+
+/**
+ * @brief delete a file, its clusters are freed and discarded, exfat is not supported
+ *
+ * @param path
+ * @return int 0-ok, other-fail
+ */
+int tf_file_delete(const char* path);
+
+/**
+ * @brief shrink a file, the clusters after the new size are freed and discarded, exfat is not supported
+ *
+ * the file ptr is moved to the new end if it is beyond
+ *
+ * @param file should be really file
+ * @param size new size, no more than the file size
+ * @return int 0-ok, other-fail
+ */
+int tf_file_truncate(tf_file_t* file, uint32_t size);
+
+/**
+ * @brief start appending to a file through a buffer
+ *
+ * the records are gathered in buffer; when it is full, its whole sectors are written, so the data sectors are
+ * written once each; the clusters are allocated as needed, after the file chain if they are free; the size in
+ * dir item is updated only at sync, which is done by `tf_append_sync`, or by the time threshold
+ *
+ * @param ap append handle
+ * @param file should be really file, kept until the last sync; not read or written by others when appending
+ * @param buffer kept until the last sync, a sector at least, larger for less i/o, such as a cluster
+ * @param size bytes of buffer, a multiple of sector size
+ * @param max_age time threshold of sync, in the unit of the `now` given, 0-none
+ * @return int 0-ok, TF_ERR_NOT_SUPPORTED-exfat volume, other-fail
+ */
+int tf_append_open(tf_append_t* ap, tf_file_t* file, uint8_t* buffer, uint32_t size, uint32_t max_age);
+
+/**
+ * @brief append a record, the full buffer is written, and the file is synced if the time threshold is passed
+ *
+ * @param ap
+ * @param data
+ * @param size
+ * @param now current time, such as a tick of ms, for the time threshold
+ * @return int 0-ok, TF_ERR_NO_SPACE-volume full, other-fail
+ */
+int tf_append_write(tf_append_t* ap, const uint8_t* data, uint32_t size, uint32_t now);
+
+/**
+ * @brief sync the file if the time threshold is passed, for an idle logger
+ *
+ * @param ap
+ * @param now current time
+ * @return int 0-ok, other-fail
+ */
+int tf_append_poll(tf_append_t* ap, uint32_t now);
+
+/**
+ * @brief write all the bytes buffered, then the FAT and the size in dir item, and flush the device
+ *
+ * @param ap
+ * @return int 0-ok, other-fail
+ */
+int tf_append_sync(tf_append_t* ap);
+
+/**
+ * @brief copy a file, between volumes or in one volume
+ *
+ * the dst chain is allocated in one continuous free run if there is one; the src is read to a cluster buffer from
+ * heap directly, not to a pool buffer, which is a single sector and holds the FAT and dir sectors the copy needs,
+ * and written in cluster bursts; with a non-blocking src device on another device, the sectors got are written
+ * while a read is pending; the dst size is written at last, so a power loss leaves an empty dst; if the src chain
+ * is shorter than its size, the bytes got are kept and the clusters beyond them freed
+ *
+ * @param src_path absolute path of the src file
+ * @param dst_path absolute path of the dst file, truncated if exists, or created with a 8.3 name
+ * @return int 0-ok, TF_ERR_NO_MEM-no memory for a buffer, TF_ERR_NO_SPACE-fewer free clusters than the src needs,
+ *         TF_ERR_NOT_SUPPORTED-dst is exfat, TF_ERR_LFN_NOT_SUPPORTED-dst name not 8.3, other-fail; on a failure
+ *         the clusters taken for an empty dst are freed
+ */
+int tf_copy(const char* src_path, const char* dst_path);
+
+/**
+ * @brief make a RAM disk on a memory area, for tests and benchmarks without disk noise, or a base image
+ *
+ * @param rd RAM disk, its ops are given to `tf_mount`, kept until unmount
+ * @param data sectors, such as an image loaded or mapped, kept until unmount
+ * @param size bytes of data
+ * @param read_only writes are refused, the data is never changed
+ * @return int 0-ok, other-fail
+ */
+int tf_ramdisk_open(tf_ramdisk_t* rd, uint8_t* data, uint32_t size, bool read_only);
+
+/**
+ * @brief make a copy-on-write overlay on a base device, the base is only read, so several overlays could share it
+ *
+ * the sectors written are kept in the pool, found by a hash index from heap; reads take the pool sectors first, the
+ * others from base, runs of base sectors by multi-sector read
+ *
+ * @param ov overlay, its ops are given to `tf_mount`, kept until unmount
+ * @param base base device ops, `read` is a must
+ * @param pool delta sectors, kept until closed
+ * @param size bytes of pool, writes fail when it is full
+ * @param sec_size sector size of the volume
+ * @return int 0-ok, TF_ERR_NO_MEM-no memory for the index, other-fail
+ */
+int tf_overlay_open(tf_overlay_t* ov, const tf_disk_ops_t* base, uint8_t* pool, uint32_t size, uint16_t sec_size);
+
+/**
+ * @brief drop all the sectors written, the overlay is the same as base again, it should not be mounted
+ *
+ * @param ov
+ * @return int 0-ok, other-fail
+ */
+int tf_overlay_reset(tf_overlay_t* ov);
+
+/**
+ * @brief free the index of an overlay, after unmount
+ *
+ * @param ov
+ * @return int 0-ok, other-fail
+ */
+int tf_overlay_close(tf_overlay_t* ov);
+
+/**
+ * @brief count the clusters and extents (continuous cluster runs) of a file
+ *
+ * @param file
+ * @param clus_num cluster count, result value
+ * @param extent_num extent count, result value
+ * @return int 0-ok, other-fail
+ */
+int tf_file_extents(tf_file_t* file, uint32_t* clus_num, uint32_t* extent_num);
+
+/**
+ * @brief scan all the files under a dir recursively, report how they are fragmented
+ *
+ * @param path absolute path of the dir
+ * @param report result value
+ * @return int 0-ok, other-fail
+ */
+int tf_frag_scan(const char* path, tf_frag_report_t* report);
+
+/**
+ * @brief move file data into one continuous free cluster run, the file ptr is kept
+ *
+ * data is copied first, then the new chain and the dir item are written, the old chain is freed at last
+ *
+ * @param file should be really file
+ * @return int 0-ok, TF_ERR_NO_SPACE-no free run large enough, TF_ERR_NOT_SUPPORTED-exfat volume, other-fail
+ */
+int tf_defrag_file(tf_file_t* file);
+
+/**
+ * @brief walk all the items under a dir breadth first, level by level
+ *
+ * the dirs of a level are scanned in the order of their first clusters, so the dir clusters are read along the
+ * disk; each dir waiting to be scanned takes a node from heap
+ *
+ * @param path absolute path of the dir
+ * @param cb called for each item except ".", ".." and volume label
+ * @param ctx user context, given to cb
+ * @param flags bitmap of TF_WALK_*
+ * @return int 0-ok, TF_ERR_NO_MEM-no memory for the dir queue, value of cb-stopped by cb, other-fail
+ */
+int tf_walk(const char* path, tf_walk_cb_t cb, void* ctx, uint8_t flags);
+
+/**
+ * @brief check a volume, such as after a power loss: the chains reached from the dir tree are marked in a cluster
+ *        bitmap from heap, then the whole FAT is scanned against it, several sectors a read
+ *
+ * repair: a chain is cut before a cross-linked or broken part, or after the clusters its size needs, the size of a
+ * file is cut to its chain, a dir left without cluster is removed, the lost clusters are freed, the other FATs are
+ * written the same as the first one, and the free count is written at unmount
+ *
+ * @param path root dir of the volume, like "/" or "x:/"
+ * @param flags bitmap of TF_CHECK_*
+ * @param report result value
+ * @return int 0-checked, see report, TF_ERR_NO_MEM-no memory for the bitmap, TF_ERR_NOT_SUPPORTED-exfat volume or
+ *         repair on read only device, other-fail
+ */
+int tf_check(const char* path, uint8_t flags, tf_check_report_t* report);
+
+/**
+ * @brief find the items matching a glob under a dir, the glob is compiled to a pattern of the sfn field, and the
+ *        raw dir items are matched before parsed, so the ones not wanted cost no item and no name
+ *
+ * the name and the extension are matched apart: `*` should be the last char of its part, `?` matches a char, a
+ * glob without '.' ending with `*` matches any extension; the files with long names are matched by their 8.3
+ * aliases only, such as "LONGFI~1.TXT"; the exfat names are matched if they are 8.3
+ *
+ * @param path absolute path of the dir
+ * @param glob like "*.CFG" or "LOG*.TXT", case insensitive
+ * @param flags bitmap of TF_FIND_RECURSIVE and TF_WALK_*; recursive, the dirs are walked as `tf_walk` does
+ * @param cb called for each item matched, as `tf_walk` does
+ * @param ctx user context, given to cb
+ * @return int 0-ok, TF_ERR_FNAME_IVALID-glob could not be matched on sfn, such as "A.B.C", value of cb-stopped by
+ *         cb, other-fail
+ */
+int tf_find(const char* path, const char* glob, uint8_t flags, tf_walk_cb_t cb, void* ctx);
+
+/**
+ * @brief get the name of a file or dir, the exfat name or the name from sfn
+ *
+ * @param item
+ * @param name result value, TF_NAME_LEN_MAX bytes at least
+ * @return int 0-ok, other-fail
+ */
+int tf_item_get_name(const tf_item_t* item, char* name);
+
+/**
+ * @brief get the time info of a file or dir, decoded from the raw dir item
+ *
+ * @param item the root dir has no time info
+ * @param write_time last write time, result value, could be nullptr
+ * @param create_time create time, result value, could be nullptr
  * @return int 0-ok, other-fail
  */
-extern int tf_disk_read(int device, uint32_t sec_id, uint16_t sec_size, uint8_t* data);
+int tf_item_get_times(const tf_item_t* item, tf_time_t* write_time, tf_time_t* create_time);
 
 // tbd
 /*
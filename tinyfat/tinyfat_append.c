@@ -0,0 +1,289 @@
+#include "tinyfat.h"
+#include "tinyfat_priv.h"
+
+
+/**
+ * @brief start appending, see `tf_append_open`
+ *
+ * the chain is walked once to find the cluster of the tail sector and the last cluster, the tail sector is loaded
+ * to buffer, so the buffer always starts at a sector
+ *
+ * @param ap
+ * @param file
+ * @param buffer
+ * @param size
+ * @param max_age
+ * @return int 0-ok, other-fail
+ */
+static int tf_append_start(tf_append_t* ap, tf_file_t* file, uint8_t* buffer, uint32_t size, uint32_t max_age)
+{
+    if (ap == nullptr || file == nullptr || file->fs == nullptr || buffer == nullptr) {
+        return TF_ERR_PARAM;
+    }
+    if (TF_MASK_MATCH(file->attr, TF_ATTR_DIRECTORY) || file->raw_sec == TF_INVALID_SECTOR_ID) {
+        return TF_ERR_PARAM;
+    }
+
+    tf_fs_t* fs = file->fs;
+    if (fs->type != TF_FS_FAT32) {   // exfat is read only
+        return TF_ERR_NOT_SUPPORTED;
+    }
+    if (size == 0 || (size & TF_SEC_MASK(fs)) != 0) {
+        return TF_ERR_PARAM;
+    }
+
+    ap->file      = file;
+    ap->buffer    = buffer;
+    ap->buf_size  = size;
+    ap->base      = file->size & ~TF_SEC_MASK(fs);
+    ap->buf_len   = file->size - ap->base;
+    ap->clus      = 0;
+    ap->last_clus = 0;
+    ap->clus_num  = 0;
+    ap->max_age   = max_age;
+    ap->stamp     = 0;
+    file->flags &= ~TF_ITEM_NO_FAT_CHAIN;   // one extent by the snapshot, not after appended
+
+    uint32_t base_idx = ap->base >> TF_CLUS_SHIFT(fs);
+    uint32_t clus     = file->first_clus;
+    while (TF_CLUSTER_ID_VALID(clus) && clus >= 2) {
+        if (clus >= fs->clus_num_total + 2 || ap->clus_num >= fs->clus_num_total) {   // broken chain
+            return TF_ERR_DISKACCESS;
+        }
+        if (ap->clus_num == base_idx) {
+            ap->clus = clus;
+        }
+        ap->last_clus = clus;
+        ap->clus_num++;
+        clus = tf_next_cluster(fs, clus);
+    }
+    if (clus == TF_INVALID_CLUSTER_ID ||
+        ap->clus_num < (file->size >> TF_CLUS_SHIFT(fs)) + ((file->size & TF_CLUS_MASK(fs)) != 0)) {
+        return TF_ERR_DISKACCESS;   // chain shorter than size
+    }
+
+    if (ap->buf_len == 0) {
+        return 0;
+    }
+    uint32_t sec_id = TF_CLUS2SEC(fs, ap->clus) + ((ap->base >> TF_SEC_SHIFT(fs)) & (TF_CLUS_SEC_NUM(fs) - 1));
+    return tf_fs_disk_read_burst(fs, sec_id, 1, buffer) == 0 ? 0 : TF_ERR_DISKACCESS;
+}
+
+
+/**
+ * @brief write the whole sectors of buffer, and the tail sector if all; the clusters are allocated as needed
+ *
+ * the sectors written are dropped from buffer but the tail one, so the next bytes go on in it
+ *
+ * @param ap
+ * @param all the tail sector is written too
+ * @return int 0-ok, other-fail
+ */
+static int tf_append_spill(tf_append_t* ap, bool all)
+{
+    tf_fs_t* fs        = ap->file->fs;
+    uint32_t sec_num   = ap->buf_len >> TF_SEC_SHIFT(fs);   // whole sectors
+    uint32_t tail      = ap->buf_len & TF_SEC_MASK(fs);
+    uint32_t write_num = sec_num + (all && tail != 0);
+    int      ret;
+
+    if (write_num == 0) {
+        return 0;
+    }
+    if (all && tail != 0) {   // no stale bytes after the file end
+        memset(ap->buffer + ap->buf_len, 0, TF_SEC_SIZE(fs) - tail);
+    }
+
+    uint32_t need = ((ap->base + ((write_num << TF_SEC_SHIFT(fs)) - 1)) >> TF_CLUS_SHIFT(fs)) + 1;
+    if (need > ap->clus_num) {
+        uint32_t first;
+        ret = tf_fat_alloc(fs, &ap->last_clus, need - ap->clus_num, &first);
+        if (ret != 0) {
+            return ret;
+        }
+        if (ap->clus == 0) {   // base is at the end of chain
+            ap->clus = first;
+        }
+        if (ap->file->first_clus < 2) {   // written to dir item at sync
+            ap->file->first_clus = first;
+        }
+        ap->clus_num = need;
+    }
+
+    // cluster by cluster, the sectors in a cluster are written together
+    uint32_t clus      = ap->clus;
+    uint32_t base_clus = clus;   // cluster of the new base
+    for (uint32_t done = 0; done < write_num;) {
+        uint32_t in_clus = ((ap->base >> TF_SEC_SHIFT(fs)) + done) & (TF_CLUS_SEC_NUM(fs) - 1);
+        uint32_t n       = util_min2(TF_CLUS_SEC_NUM(fs) - in_clus, ((done < sec_num) ? sec_num : write_num) - done);
+        if (clus < 2) {   // chain shorter than allocated
+            return TF_ERR_DISKACCESS;
+        }
+
+        ret = tf_fs_disk_write_burst(fs, TF_CLUS2SEC(fs, clus) + in_clus, n, ap->buffer + (done << TF_SEC_SHIFT(fs)));
+        if (ret != 0) {
+            return ret;
+        }
+        done += n;
+        if (in_clus + n == TF_CLUS_SEC_NUM(fs)) {   // cluster end
+            clus = tf_next_cluster(fs, clus);
+            if (clus == TF_INVALID_CLUSTER_ID) {
+                return TF_ERR_DISKACCESS;
+            }
+            clus = TF_CLUSTER_ID_VALID(clus) ? clus : 0;
+        }
+        if (done == sec_num) {
+            base_clus = clus;
+        }
+    }
+
+    uint32_t drop = sec_num << TF_SEC_SHIFT(fs);
+    memmove(ap->buffer, ap->buffer + drop, ap->buf_len - drop);
+    ap->base += drop;
+    ap->buf_len -= drop;
+    ap->clus = base_clus;
+    return 0;
+}
+
+
+/**
+ * @brief write all the bytes buffered, then the FAT and the dir item, see `tf_append_sync`
+ *
+ * @param ap
+ * @return int 0-ok, other-fail
+ */
+static int tf_append_flush(tf_append_t* ap)
+{
+    tf_file_t* file = ap->file;
+    tf_fs_t*   fs   = file->fs;
+    uint32_t   size = ap->base + ap->buf_len;
+
+    if (size == file->size) {
+        return 0;
+    }
+
+    // data first, then FAT, then the dir item, a power loss leaves lost clusters only
+    int ret = tf_append_spill(ap, true);
+    if (ret == 0) {
+        ret = tf_fat_flush(fs);
+    }
+    if (ret != 0) {
+        return ret;
+    }
+
+    util_uint2bytes_le(file->raw + 20, file->first_clus >> 16, 2);   // DIR_FstClusHI
+    util_uint2bytes_le(file->raw + 26, file->first_clus, 2);         // DIR_FstClusLO
+    util_uint2bytes_le(file->raw + 28, size, 4);                     // DIR_FileSize
+    tf_item_stamp(file->raw, false);
+    if (tf_item_raw_update(file) != 0) {
+        return TF_ERR_DISKACCESS;
+    }
+    file->size = size;
+    if (file->cur_ofs == 0) {
+        file->cur_clus = file->first_clus;
+    }
+    return tf_fs_disk_flush(fs) == 0 ? 0 : TF_ERR_DISKACCESS;
+}
+
+
+/**
+ * @brief sync the file if the first byte not synced is old enough
+ *
+ * @param ap
+ * @param now
+ * @return int 0-ok, other-fail
+ */
+static int tf_append_age(tf_append_t* ap, uint32_t now)
+{
+    if (ap->max_age == 0 || ap->base + ap->buf_len == ap->file->size || now - ap->stamp < ap->max_age) {
+        return 0;
+    }
+    return tf_append_flush(ap);
+}
+
+
+/**
+ * @brief append a record, see `tf_append_write`
+ *
+ * @param ap
+ * @param data
+ * @param size
+ * @param now
+ * @return int 0-ok, other-fail
+ */
+static int tf_append_data(tf_append_t* ap, const uint8_t* data, uint32_t size, uint32_t now)
+{
+    if (size > UINT32_MAX - ap->base - ap->buf_len) {   // file size limit
+        return TF_ERR_NO_SPACE;
+    }
+    if (size > 0 && ap->base + ap->buf_len == ap->file->size) {   // the first byte not synced
+        ap->stamp = now;
+    }
+
+    while (size > 0) {
+        uint32_t n = util_min2(size, ap->buf_size - ap->buf_len);
+        memcpy(ap->buffer + ap->buf_len, data, n);
+        ap->buf_len += n;
+        data += n;
+        size -= n;
+
+        if (ap->buf_len == ap->buf_size) {
+            int ret = tf_append_spill(ap, false);
+            if (ret != 0) {
+                return ret;
+            }
+        }
+    }
+    return tf_append_age(ap, now);
+}
+
+
+/**
+ * @brief take the bytes put to buffer directly, at `buffer + buf_len`, so no copy is made; the full buffer is written
+ *
+ * @param ap
+ * @param size bytes put, no more than `buf_size - buf_len`
+ * @param early the whole sectors are written now even if the buffer is not full, such as when a read is pending
+ * @return int 0-ok, other-fail
+ */
+int tf_append_commit(tf_append_t* ap, uint32_t size, bool early)
+{
+    if (size > UINT32_MAX - ap->base - ap->buf_len) {   // file size limit
+        return TF_ERR_NO_SPACE;
+    }
+    ap->buf_len += size;
+    return (early || ap->buf_len == ap->buf_size) ? tf_append_spill(ap, false) : 0;
+}
+
+
+int tf_append_open(tf_append_t* ap, tf_file_t* file, uint8_t* buffer, uint32_t size, uint32_t max_age)
+{
+    return TF_PROF(TF_PROF_APPEND, TF_IO_WAIT(tf_append_start(ap, file, buffer, size, max_age)));
+}
+
+
+int tf_append_write(tf_append_t* ap, const uint8_t* data, uint32_t size, uint32_t now)
+{
+    if (ap == nullptr || ap->file == nullptr || (data == nullptr && size > 0)) {
+        return TF_ERR_PARAM;
+    }
+    return TF_PROF(TF_PROF_APPEND, TF_IO_WAIT(tf_append_data(ap, data, size, now)));
+}
+
+
+int tf_append_poll(tf_append_t* ap, uint32_t now)
+{
+    if (ap == nullptr || ap->file == nullptr) {
+        return TF_ERR_PARAM;
+    }
+    return TF_PROF(TF_PROF_APPEND, TF_IO_WAIT(tf_append_age(ap, now)));
+}
+
+
+int tf_append_sync(tf_append_t* ap)
+{
+    if (ap == nullptr || ap->file == nullptr) {
+        return TF_ERR_PARAM;
+    }
+    return TF_PROF(TF_PROF_APPEND, TF_IO_WAIT(tf_append_flush(ap)));
+}
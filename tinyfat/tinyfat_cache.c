@@ -0,0 +1,242 @@
+#include "tinyfat.h"
+#include "tinyfat_priv.h"
+
+#if TF_CACHE_POOL_NUM < 2
+#error "TF_CACHE_POOL_NUM should be at least 2, the data sector and the FAT sector of a volume are used together"
+#endif
+
+static tf_cache_buf_t cache_pool[TF_CACHE_POOL_NUM];
+static uint32_t       cache_stamp;          // increased by each access, for LRU
+static uint16_t       cache_weight_total;   // weight sum of mounted volumes
+
+
+/**
+ * @brief write a dirty buffer back, a FAT sector is written to all FATs
+ *
+ * @param buf
+ * @return int 0-ok, other-fail
+ */
+static int tf_cache_writeback(tf_cache_buf_t* buf)
+{
+    tf_fs_t* fs  = buf->fs;
+    uint8_t  num = (buf->sec_id - fs->fat_sec_ofs < fs->fat_sec_num) ? fs->fat_num : 1;
+
+    for (uint8_t i = 0; i < num; i++) {
+        int ret = tf_fs_disk_write_burst(fs, buf->sec_id + i * fs->fat_sec_num, 1, (uint8_t*)buf->data);
+        if (ret != 0) {
+            return ret;
+        }
+    }
+    buf->dirty = false;
+    return 0;
+}
+
+
+/**
+ * @brief reuse order of a buffer, the lower one is reused first
+ *
+ * the buffers of the volumes over their share go first, then by kind: data, meta loaded once, hot meta, so a
+ * stream of data or a scan of dir goes through the cold buffers without wiping out the hot FAT and dir sectors
+ *
+ * share of a volume is `TF_CACHE_POOL_NUM * weight / weight sum`, the volume with weight 0 has no share
+ *
+ * @param buf
+ * @return uint8_t
+ */
+static uint8_t tf_cache_rank(const tf_cache_buf_t* buf)
+{
+    bool over = (uint32_t)buf->fs->cache_num * cache_weight_total > TF_CACHE_POOL_NUM * buf->fs->cache_weight;
+    return (over ? 0 : 3) + buf->kind + buf->hot;
+}
+
+
+/**
+ * @brief choose the buffer to reuse: a free one, or the least recently used one of the lowest rank
+ *
+ * @param keep the buffer still in use, not reused
+ * @param near the buffer reused only if no other one could be, could be nullptr
+ * @return tf_cache_buf_t* nullptr if all buffers are pinned
+ */
+static tf_cache_buf_t* tf_cache_victim(const tf_cache_buf_t* keep, const tf_cache_buf_t* near)
+{
+    tf_cache_buf_t* victim      = nullptr;
+    uint8_t         victim_rank = 0;
+
+    for (int i = 0; i < TF_CACHE_POOL_NUM; i++) {
+        tf_cache_buf_t* buf = &cache_pool[i];
+        if (buf->fs == nullptr) {
+            return buf;
+        }
+        if (buf->pinned || buf == keep) {
+            continue;
+        }
+
+        uint8_t rank = (buf == near) ? UINT8_MAX : tf_cache_rank(buf);
+        if (victim == nullptr || rank < victim_rank ||
+            (rank == victim_rank && (int32_t)(buf->stamp - victim->stamp) < 0)) {
+            victim      = buf;
+            victim_rank = rank;
+        }
+    }
+    return victim;
+}
+
+
+/**
+ * @brief mark a meta buffer hot, the least recently used hot one is cooled if there are too many
+ *
+ * @param hot
+ */
+static void tf_cache_promote(tf_cache_buf_t* hot)
+{
+    tf_cache_buf_t* oldest = nullptr;
+    uint8_t         num    = 0;
+
+    hot->hot = true;
+    for (int i = 0; i < TF_CACHE_POOL_NUM; i++) {
+        tf_cache_buf_t* buf = &cache_pool[i];
+        if (buf->fs != nullptr && buf->hot) {
+            num++;
+            if (oldest == nullptr || (int32_t)(buf->stamp - oldest->stamp) < 0) {
+                oldest = buf;
+            }
+        }
+    }
+    if (num > TF_CACHE_HOT_MAX) {
+        oldest->hot = false;
+    }
+}
+
+
+/**
+ * @brief get the buffer of a sector, read from disk if not cached
+ *
+ * the meta sector becomes hot if it is accessed again after the volume has used other sectors, the accesses to
+ * the sector in use, such as the dir items in one sector, are counted as one
+ *
+ * a meta read keeps the sector the volume used last if it could, a dir entry set may cross the sectors, and a
+ * pending read should not drop the sector to go on with
+ *
+ * @param fs
+ * @param sec_id
+ * @param kind TF_CACHE_DATA or TF_CACHE_META
+ * @param keep the buffer still in use, not reused, could be nullptr
+ * @param buf result value
+ * @return int 0-ok, TF_ERR_CACHE_PINNED-no buffer could be reused, TF_PENDING-read not done, other-fail
+ */
+int tf_cache_get(tf_fs_t* fs, uint32_t sec_id, uint8_t kind, const tf_cache_buf_t* keep, tf_cache_buf_t** buf)
+{
+    tf_trace_record(fs, sec_id, 1, kind == TF_CACHE_META ? TF_TRACE_META : TF_TRACE_DATA);
+
+    for (int i = 0; i < TF_CACHE_POOL_NUM; i++) {
+        tf_cache_buf_t* hit = &cache_pool[i];
+        if (hit->fs == fs && hit->sec_id == sec_id) {
+            hit->stamp = ++cache_stamp;
+            hit->kind |= kind;
+            if (hit->kind == TF_CACHE_META && !hit->hot && hit != fs->cache_buf && hit != fs->fatcache_buf) {
+                tf_cache_promote(hit);
+            }
+            *buf = hit;
+            return 0;
+        }
+    }
+
+    tf_cache_buf_t* victim = tf_cache_victim(keep, (kind == TF_CACHE_META) ? fs->cache_buf : nullptr);
+    if (victim == nullptr) {
+        return TF_ERR_CACHE_PINNED;
+    }
+    if (victim->fs != nullptr) {
+        if (victim->dirty && tf_cache_writeback(victim) != 0) {
+            return TF_ERR_DISKACCESS;
+        }
+        victim->fs->cache_num--;
+        victim->fs = nullptr;
+    }
+
+    int ret = tf_fs_disk_read_op(fs, sec_id, 1, (uint8_t*)victim->data);
+    if (ret != 0) {
+        return ret;
+    }
+    victim->fs     = fs;
+    victim->sec_id = sec_id;
+    victim->stamp  = ++cache_stamp;
+    victim->kind   = kind;
+    victim->hot    = false;
+    fs->cache_num++;
+    *buf = victim;
+    return 0;
+}
+
+
+/**
+ * @brief copy the written sectors to their buffers, so the cache is kept the same as disk
+ *
+ * @param fs
+ * @param sec_id first sector id
+ * @param count sector count
+ * @param data written data
+ */
+void tf_cache_update(tf_fs_t* fs, uint32_t sec_id, uint32_t count, const uint8_t* data)
+{
+    for (int i = 0; i < TF_CACHE_POOL_NUM; i++) {
+        tf_cache_buf_t* buf = &cache_pool[i];
+        uint32_t        idx = buf->sec_id - sec_id;
+        if (buf->fs == fs && idx < count && data + (idx << TF_SEC_SHIFT(fs)) != (uint8_t*)buf->data) {
+            memcpy(buf->data, data + (idx << TF_SEC_SHIFT(fs)), fs->sec_size);
+        }
+    }
+}
+
+
+/**
+ * @brief drop the buffers of some sectors, dirty ones are not written
+ *
+ * @param fs
+ * @param sec_id first sector id
+ * @param count sector count
+ */
+void tf_cache_drop(tf_fs_t* fs, uint32_t sec_id, uint32_t count)
+{
+    for (int i = 0; i < TF_CACHE_POOL_NUM; i++) {
+        tf_cache_buf_t* buf = &cache_pool[i];
+        if (buf->fs == fs && buf->sec_id - sec_id < count) {
+            buf->fs     = nullptr;
+            buf->dirty  = false;
+            buf->pinned = false;
+            fs->cache_num--;
+        }
+    }
+}
+
+
+/**
+ * @brief write all the dirty buffers of a volume back
+ *
+ * @param fs
+ * @return int 0-ok, other-fail
+ */
+int tf_cache_flush(tf_fs_t* fs)
+{
+    for (int i = 0; i < TF_CACHE_POOL_NUM; i++) {
+        if (cache_pool[i].fs == fs && cache_pool[i].dirty) {
+            int ret = tf_cache_writeback(&cache_pool[i]);
+            if (ret != 0) {
+                return ret;
+            }
+        }
+    }
+    return 0;
+}
+
+
+/**
+ * @brief set the weight of a volume, the buffers are shared by weight
+ *
+ * @param fs
+ * @param weight 0-detach the volume, or no share
+ */
+void tf_cache_weight(tf_fs_t* fs, uint8_t weight)
+{
+    cache_weight_total = cache_weight_total - fs->cache_weight + weight;
+    fs->cache_weight   = weight;
+}
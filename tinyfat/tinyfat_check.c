@@ -0,0 +1,270 @@
+#include "tinyfat.h"
+#include "tinyfat_mem.h"
+#include "tinyfat_priv.h"
+
+#define TF_FAT_BAD 0x0FFFFFF7   // bad cluster, used but in no chain
+
+typedef struct {
+    tf_fs_t*           fs;
+    uint8_t            flags;    // bitmap of TF_CHECK_*
+    uint8_t*           bitmap;   // clusters reached from the dir tree, bit per cluster
+    tf_check_report_t* report;
+} tf_check_t;
+
+
+#define TF_CHECK_BIT(ck, clus)     ((ck)->bitmap[(clus) >> 3] & (1u << ((clus) & 7)))
+#define TF_CHECK_BIT_SET(ck, clus) ((ck)->bitmap[(clus) >> 3] |= (1u << ((clus) & 7)))
+
+
+/**
+ * @brief walk the chain of an item, mark its clusters, check it against the size of item
+ *
+ * a chain running into the clusters marked already is cross-linked, a chain running into a free or out of range
+ * cluster is broken; when repairing, the chain is cut before them or after the clusters the size needs, and the
+ * size of a file is cut to its chain, the clusters cut off are freed as lost ones later
+ *
+ * @param ck
+ * @param item
+ * @return int 0-ok, TF_WALK_SKIP-the first cluster of the dir is cross-linked, not gone into, other-fail
+ */
+static int tf_check_chain(tf_check_t* ck, tf_item_t* item)
+{
+    tf_fs_t*           fs     = ck->fs;
+    tf_check_report_t* report = ck->report;
+    bool               is_dir = TF_MASK_MATCH(item->attr, TF_ATTR_DIRECTORY);
+    uint32_t           expect = (item->size >> TF_CLUS_SHIFT(fs)) + ((item->size & TF_CLUS_MASK(fs)) != 0);
+    uint32_t           clus   = item->first_clus;
+    uint32_t           last   = 0;
+    uint32_t           num    = 0;
+    bool               cut    = false;   // chain should end at last
+    int                ret    = 0;
+
+    if (is_dir) {   // no size
+        expect = UINT32_MAX;
+    }
+    while (clus != 0 || num != 0) {   // no chain if the first cluster is 0
+        if (!TF_CLUSTER_ID_VALID(clus)) {   // end of chain
+            break;
+        }
+        if (clus < 2 || clus >= fs->clus_num_total + 2) {   // free, reserved, bad or out of range
+            report->bad_chain_num++;
+            cut = true;
+            break;
+        }
+        if (TF_CHECK_BIT(ck, clus)) {
+            report->cross_link_num++;
+            cut = true;
+            ret = (is_dir && num == 0) ? TF_WALK_SKIP : 0;   // a dir cut after its own clusters is still walked
+            break;
+        }
+        if (num == expect) {   // longer than size
+            report->bad_size_num++;
+            cut = true;
+            break;
+        }
+
+        TF_CHECK_BIT_SET(ck, clus);
+        report->used_clus_num++;
+        num++;
+        last = clus;
+        clus = tf_next_cluster(fs, clus);
+        if (clus == TF_INVALID_CLUSTER_ID) {
+            return TF_ERR_DISKACCESS;
+        }
+    }
+    bool short_size = !is_dir && num < expect;
+    if (short_size && !cut) {
+        report->bad_size_num++;
+    }
+    if (!(ck->flags & TF_CHECK_REPAIR) || !(cut || short_size)) {
+        return ret;
+    }
+
+    if (last != 0) {
+        if (cut && tf_fat_set(fs, last, TF_FAT_EOC) != 0) {
+            return TF_ERR_DISKACCESS;
+        }
+    } else if (item->raw_sec == TF_INVALID_SECTOR_ID) {   // root dir without a good cluster, could not repair
+        return ret;
+    } else if (is_dir) {   // dir without a good cluster, removed
+        item->raw[0] = TF_ATTR_DELETED;
+        ret          = TF_WALK_SKIP;
+    } else {
+        util_uint2bytes_le(item->raw + 20, 0, 2);   // DIR_FstClusHI
+        util_uint2bytes_le(item->raw + 26, 0, 2);   // DIR_FstClusLO
+        item->first_clus = 0;
+    }
+    if (short_size) {
+        item->size = num << TF_CLUS_SHIFT(fs);
+        util_uint2bytes_le(item->raw + 28, item->size, 4);   // DIR_FileSize
+    }
+    if ((last == 0 || short_size) && tf_item_raw_update(item) != 0) {
+        return TF_ERR_DISKACCESS;
+    }
+    report->repaired_num++;
+    return ret;
+}
+
+
+/**
+ * @brief walk callback, checks the chain of each item
+ */
+static int tf_check_item(void* ctx, const char* path, tf_item_t* item, uint16_t depth)
+{
+    tf_check_t* ck = (tf_check_t*)ctx;
+
+    util_unused(path);
+    util_unused(depth);
+    if (TF_MASK_MATCH(item->attr, TF_ATTR_DIRECTORY)) {
+        ck->report->dir_num++;
+    } else {
+        ck->report->file_num++;
+    }
+    return tf_check_chain(ck, item);
+}
+
+
+/**
+ * @brief scan the whole FAT several sectors a read, find the lost clusters and the FAT copies differing
+ *
+ * a used cluster not reached from the dir tree is lost; when repairing, the lost clusters are freed and the other
+ * FATs are written the same as the first one
+ *
+ * @param ck
+ * @return int 0-ok, other-fail
+ */
+static int tf_check_fat(tf_check_t* ck)
+{
+    tf_fs_t*           fs      = ck->fs;
+    tf_check_report_t* report  = ck->report;
+    uint32_t           sec_num = TF_FAT_SCAN_SEC_NUM;
+    uint32_t           ent_num = fs->clus_num_total + 2;   // entry 0 and 1 are reserved
+    uint32_t*          fat     = (uint32_t*)tf_malloc(sec_num * fs->sec_size * 2);
+    uint32_t*          copy    = fat + sec_num * fs->sec_size / 4;   // the same piece of another FAT
+    int                ret     = 0;
+
+    if (fat == nullptr) {
+        return TF_ERR_NO_MEM;
+    }
+    if (tf_fat_flush(fs) != 0) {   // the modified FAT sectors are read from disk
+        tf_free(fat);
+        return TF_ERR_DISKACCESS;
+    }
+
+    uint32_t ent_per_sec = fs->sec_size / 4;
+    for (uint32_t sec = 0; sec < fs->fat_sec_num && sec * ent_per_sec < ent_num && ret == 0; sec += sec_num) {
+        uint32_t n     = util_min2(sec_num, fs->fat_sec_num - sec);
+        uint32_t first = sec * ent_per_sec;   // cluster id of fat[0]
+        bool     dirty = false;               // lost clusters freed
+        bool     diff  = false;               // other FATs differ
+
+        ret = tf_fs_disk_read_burst(fs, fs->fat_sec_ofs + sec, n, (uint8_t*)fat);
+        for (uint8_t f = 1; ret == 0 && f < fs->fat_num; f++) {
+            ret = tf_fs_disk_read_burst(fs, fs->fat_sec_ofs + f * fs->fat_sec_num + sec, n, (uint8_t*)copy);
+            for (uint32_t s = 0; ret == 0 && s < n; s++) {
+                if (memcmp(fat + s * ent_per_sec, copy + s * ent_per_sec, fs->sec_size) != 0) {
+                    report->fat_diff_sec_num++;
+                    diff = true;
+                }
+            }
+        }
+
+        for (uint32_t i = 0; ret == 0 && i < n * ent_per_sec && first + i < ent_num; i++) {
+            uint32_t clus  = first + i;
+            uint32_t entry = fat[i] & TF_FAT_ENTRY_MASK;
+            if (clus < 2 || TF_CHECK_BIT(ck, clus) || entry == TF_FAT_BAD) {
+                continue;
+            }
+            if (entry == TF_FAT_FREE) {
+                report->free_clus_num++;
+            } else {
+                report->lost_clus_num++;
+                if (ck->flags & TF_CHECK_REPAIR) {
+                    fat[i] &= ~TF_FAT_ENTRY_MASK;   // keep the reserved high 4 bits
+                    report->free_clus_num++;
+                    dirty = true;
+                }
+            }
+        }
+
+        if (ret != 0 || !(ck->flags & TF_CHECK_REPAIR) || !(dirty || diff)) {
+            continue;
+        }
+        for (uint8_t f = dirty ? 0 : 1; ret == 0 && f < fs->fat_num; f++) {   // the first FAT is trusted
+            ret = tf_fs_disk_write_burst(fs, fs->fat_sec_ofs + f * fs->fat_sec_num + sec, n, (uint8_t*)fat);
+        }
+        report->repaired_num += dirty + diff;
+    }
+
+    tf_free(fat);
+    return ret == 0 ? 0 : TF_ERR_DISKACCESS;
+}
+
+
+/**
+ * @brief check a volume, see `tf_check`
+ *
+ * @param path
+ * @param flags
+ * @param report
+ * @return int 0-ok, other-fail
+ */
+static int tf_check_volume(const char* path, uint8_t flags, tf_check_report_t* report)
+{
+    tf_dir_t root;
+    int      ret = tf_item_open(path, &root);
+    if (ret != 0) {
+        return ret;
+    }
+    if (root.raw_sec != TF_INVALID_SECTOR_ID) {   // not the root dir
+        return TF_ERR_PARAM;
+    }
+
+    tf_check_t ck = {.fs = root.fs, .flags = flags, .report = report};
+    tf_fs_t*   fs = ck.fs;
+    if (fs->type != TF_FS_FAT32) {
+        return TF_ERR_NOT_SUPPORTED;
+    }
+    if ((flags & TF_CHECK_REPAIR) && fs->ops->write == nullptr) {
+        return TF_ERR_NOT_SUPPORTED;
+    }
+
+    ck.bitmap = (uint8_t*)tf_malloc((fs->clus_num_total + 2 + 7) / 8);
+    if (ck.bitmap == nullptr) {
+        return TF_ERR_NO_MEM;
+    }
+    memset(ck.bitmap, 0, (fs->clus_num_total + 2 + 7) / 8);
+    memset(report, 0, sizeof(tf_check_report_t));
+
+    // mark the chains reached from the dir tree, then the FAT is scanned against them
+    ret = tf_check_chain(&ck, &root);
+    if (ret == 0) {
+        ret = tf_walk(path, tf_check_item, &ck, 0);
+    }
+    if (ret == 0) {
+        ret = tf_check_fat(&ck);
+    }
+    tf_free(ck.bitmap);
+    if (ret != 0) {
+        return ret;
+    }
+
+    if (fs->free_clus_num != report->free_clus_num) {
+        report->free_count_bad = (fs->free_clus_num != TF_INVALID_FREE_COUNT);
+        fs->free_clus_num      = report->free_clus_num;   // counted now, written at unmount if repairing
+        if ((flags & TF_CHECK_REPAIR) && fs->fsinfo_sec_id != TF_INVALID_SECTOR_ID) {
+            fs->fsinfo_dirty = true;
+            report->repaired_num += report->free_count_bad;
+        }
+    }
+    return (flags & TF_CHECK_REPAIR) ? tf_fs_disk_flush(fs) : 0;
+}
+
+
+int tf_check(const char* path, uint8_t flags, tf_check_report_t* report)
+{
+    if (path == nullptr || report == nullptr) {
+        return TF_ERR_PARAM;
+    }
+    return TF_PROF(TF_PROF_CHECK, TF_IO_WAIT(tf_check_volume(path, flags, report)));
+}
@@ -2,14 +2,31 @@
 
 // config
 #define TF_MAX_FS_NUM          1     //
+#define TF_CACHE_POOL_NUM      4     // sector buffers shared by all volumes, for data, dir and FAT
 #define TF_DEFALUT_SECTOR_SIZE 512   //
 #define TF_FN_LEN_MAX          13    // format: XXXXXXXX.XXX + '\0'
 #define TF_SFN_LEN             12    // 8 + 3 + '\0'
-#define TF_LFN_SUPPORTTED      0     // long filename supported
+#define TF_LFN_SUPPORTTED      1     // long filename supported, read only
+#define TF_EXFAT_SUPPORTED     1     // exfat volume supported, read only
+#define TF_NAME_LEN_MAX        64    // long name buffer size with '\0', utf-8, no less than TF_FN_LEN_MAX
+#define TF_FAT_SCAN_SEC_NUM    8     // sectors a read when scanning the whole FAT, buffer from heap
+#define TF_FIXED_SEC_SIZE      0     // 0-read from disk, or fixed sector size, pow of 2, with TF_FIXED_CLUS_SEC_NUM
+#define TF_FIXED_CLUS_SEC_NUM  0     // 0-read from disk, or fixed sector count of a cluster, pow of 2
+#define TF_PATH_LEN_MAX        64    // max path length kept in reports
+#define TF_WALK_PATH_LEN_MAX   256   // path buffer of walk, the deeper paths given to the walk callback are cut
+#define TF_FRAG_WORST_NUM      4     // count of the most fragmented files kept in frag report
+#define TF_SNAP_ITEM_NUM       8     // items opened by path kept in the warm-start snapshot of a volume
+#define TF_TRACE_BUF_NUM       32    // trace records buffered before given to the sink
+#define TF_PROF_HIST_NUM       24    // latency histogram size of a profile point, log2 buckets of clock ticks
+#define TF_PROF_DEPTH_MAX      8     // profile points nested at most, such as an api and the disk ops in it
 #ifdef HOST_DEBUG
 #define TF_WITH_MBR            1     // set `1` for vhd file
+#define TF_TRACE_SUPPORTED     1     // disk access trace recorder, replayed by tools/tf_replay.c
+#define TF_PROF_SUPPORTED      1     // latency histograms of the apis and the disk ops
 #else
 #define TF_WITH_MBR            0     // sdcard without MBR
+#define TF_TRACE_SUPPORTED     0     //
+#define TF_PROF_SUPPORTED      0     //
 #endif
 
 #define tf_logger(...)         // util_printf(__VA_ARGS__)
@@ -0,0 +1,248 @@
+#include "tinyfat.h"
+#include "tinyfat_mem.h"
+#include "tinyfat_priv.h"
+
+
+/**
+ * @brief open the dst file of copy, an existing one is truncated, a missing one is created
+ *
+ * @param src
+ * @param path
+ * @param dst result value
+ * @return int 0-ok, other-fail
+ */
+static int tf_copy_dst_open(tf_file_t* src, const char* path, tf_file_t* dst)
+{
+    int ret = tf_item_open(path, dst);
+    if (ret == TF_ERR_PATH) {
+        return tf_item_create(path, dst);
+    }
+    if (ret != 0) {
+        return ret;
+    }
+    if (TF_MASK_MATCH(dst->attr, TF_ATTR_DIRECTORY) || dst->raw_sec == TF_INVALID_SECTOR_ID) {
+        return TF_ERR_PARAM;
+    }
+    if (dst->fs == src->fs && dst->raw_sec == src->raw_sec && dst->raw_ofs == src->raw_ofs) {   // copy to itself
+        return TF_ERR_PARAM;
+    }
+    if (dst->fs->type != TF_FS_FAT32) {   // exfat is read only
+        return TF_ERR_NOT_SUPPORTED;
+    }
+    return dst->size == 0 ? 0 : tf_file_truncate(dst, 0);
+}
+
+
+/**
+ * @brief allocate the chain of dst in one continuous free run if there is one, or it is allocated when writing
+ *
+ * @param dst empty file
+ * @param size bytes to copy
+ * @return int 0-ok, TF_ERR_NO_SPACE-fewer free clusters than size, other-fail
+ */
+static int tf_copy_prealloc(tf_file_t* dst, uint32_t size)
+{
+    tf_fs_t* fs       = dst->fs;
+    uint32_t clus_num = (size >> TF_CLUS_SHIFT(fs)) + ((size & TF_CLUS_MASK(fs)) != 0);
+    uint32_t first, last = 0;
+
+    if (clus_num == 0 || dst->first_clus >= 2) {
+        return 0;
+    }
+    int ret = (fs->free_clus_num == TF_INVALID_FREE_COUNT) ? tf_fs_count_free(fs) : 0;
+    if (ret != 0) {
+        return ret;
+    }
+    if (fs->free_clus_num < clus_num) {   // fail before any cluster is taken
+        return TF_ERR_NO_SPACE;
+    }
+    ret = tf_fat_find_free_run(fs, clus_num, &first);
+    if (ret == TF_ERR_NO_SPACE) {   // fragmented free space
+        return 0;
+    }
+    if (ret != 0) {
+        return ret;
+    }
+
+    fs->next_free_clus = first;   // the run is taken as a new chain
+    ret                = tf_fat_alloc(fs, &last, clus_num, &first);
+    if (ret == 0) {
+        dst->first_clus = first;   // written to dir item at sync
+    }
+    return ret;
+}
+
+
+/**
+ * @brief open the src and the dst of copy, the dst is empty and its chain is allocated
+ *
+ * @param src_path
+ * @param dst_path
+ * @param src result value
+ * @param dst result value
+ * @return int 0-ok, other-fail
+ */
+static int tf_copy_open(const char* src_path, const char* dst_path, tf_file_t* src, tf_file_t* dst)
+{
+    int ret = tf_item_open(src_path, src);
+    if (ret != 0) {
+        return ret;
+    }
+    if (TF_MASK_MATCH(src->attr, TF_ATTR_DIRECTORY)) {
+        return TF_ERR_PARAM;
+    }
+    ret = tf_copy_dst_open(src, dst_path, dst);
+    return ret == 0 ? tf_copy_prealloc(dst, src->size) : ret;
+}
+
+
+/**
+ * @brief move the data of src to the append buffer of dst
+ *
+ * the src is read to the buffer directly, the full buffer is written in cluster bursts; if a read of src is pending
+ * and the volumes are on different devices, the whole sectors got are written meanwhile, so the device of dst is
+ * busy while the next sectors of src are coming
+ *
+ * @param src
+ * @param ap
+ * @return int 0-ok, other-fail
+ */
+static int tf_copy_data(tf_file_t* src, tf_append_t* ap)
+{
+    bool overlap = (src->fs->device != ap->file->fs->device);
+    int  ret;
+
+    while ((ret = tf_file_read(src, ap->buffer + ap->buf_len, ap->buf_size - ap->buf_len)) != 0) {
+        if (ret == TF_PENDING) {
+            ret = overlap ? TF_IO_WAIT(tf_append_commit(ap, 0, true)) : 0;
+        } else if (ret > 0) {
+            ret = TF_IO_WAIT(tf_append_commit(ap, ret, false));
+        }
+        if (ret != 0) {
+            return ret;
+        }
+    }
+    return 0;
+}
+
+
+/**
+ * @brief free the clusters of dst beyond its size, the rest of the chain allocated for a src shorter than its size
+ *
+ * @param ap synced append buffer of dst
+ * @return int 0-ok, other-fail
+ */
+static int tf_copy_trim(tf_append_t* ap)
+{
+    tf_file_t* dst      = ap->file;
+    tf_fs_t*   fs       = dst->fs;
+    uint32_t   keep_num = (dst->size >> TF_CLUS_SHIFT(fs)) + ((dst->size & TF_CLUS_MASK(fs)) != 0);
+
+    if (ap->clus_num <= keep_num) {
+        return 0;
+    }
+    if (keep_num == 0) {   // not in dir item yet
+        uint32_t first  = dst->first_clus;
+        dst->first_clus = 0;
+        dst->cur_clus   = 0;
+        dst->hint_clus  = 0;
+        ap->last_clus   = 0;
+        ap->clus_num    = 0;
+        return (tf_fat_free_chain(fs, first) == 0 && tf_fs_disk_flush(fs) == 0) ? 0 : TF_ERR_DISKACCESS;
+    }
+
+    uint32_t last = dst->first_clus;
+    for (uint32_t i = 1; i < keep_num; i++) {
+        last = tf_next_cluster(fs, last);
+    }
+    uint32_t tail = tf_next_cluster(fs, last);
+    int      ret  = tf_fat_set(fs, last, TF_FAT_EOC);
+    if (ret == 0 && TF_CLUSTER_ID_VALID(tail) && tail >= 2) {
+        ret = tf_fat_free_chain(fs, tail);
+    }
+    if (ret == 0) {
+        ret = tf_fs_disk_flush(fs);
+    }
+    ap->last_clus = last;
+    ap->clus_num  = keep_num;
+    return ret == 0 ? 0 : TF_ERR_DISKACCESS;
+}
+
+
+/**
+ * @brief free the chain of dst on a failed copy, if it is not written to the dir item yet
+ *
+ * @param dst
+ * @return int 0-ok, other-fail
+ */
+static int tf_copy_drop(tf_file_t* dst)
+{
+    tf_fs_t* fs    = dst->fs;
+    uint32_t first = dst->first_clus;
+
+    if (dst->size != 0 || first < 2) {   // synced, the chain is cut to the bytes got
+        return 0;
+    }
+    dst->first_clus = 0;
+    dst->cur_clus   = 0;
+    dst->hint_clus  = 0;
+    return (tf_fat_free_chain(fs, first) == 0 && tf_fs_disk_flush(fs) == 0) ? 0 : TF_ERR_DISKACCESS;
+}
+
+
+/**
+ * @brief copy a file, see `tf_copy`
+ *
+ * @param src_path
+ * @param dst_path
+ * @return int 0-ok, other-fail
+ */
+static int tf_copy_file(const char* src_path, const char* dst_path)
+{
+    tf_file_t src, dst;
+    int       ret = TF_IO_WAIT(tf_copy_open(src_path, dst_path, &src, &dst));
+    if (ret != 0) {
+        return ret;
+    }
+
+    // a buffer of its own, the pool buffers are single sectors and hold the FAT and dir sectors the copy needs
+    tf_fs_t* fs     = dst.fs;
+    uint32_t size   = TF_CLUS_SIZE(fs);   // a cluster a burst, or a sector if memory is short
+    uint8_t* buffer = (uint8_t*)tf_malloc(size);
+    if (buffer == nullptr) {
+        size   = TF_SEC_SIZE(fs);
+        buffer = (uint8_t*)tf_malloc(size);
+    }
+
+    tf_append_t ap;
+    ret = (buffer == nullptr) ? TF_ERR_NO_MEM : tf_append_open(&ap, &dst, buffer, size, 0);
+    if (ret == 0) {
+        ret = tf_copy_data(&src, &ap);
+        if (ret == 0 || ret == TF_ERR_DISKACCESS) {   // the bytes got are kept, the chain is cut to them
+            int sync = tf_append_sync(&ap);
+            if (sync == 0) {
+                sync = tf_copy_trim(&ap);
+            }
+            ret = (ret == 0) ? sync : ret;
+        }
+    }
+    if (ret == 0 && dst.size != src.size) {   // src chain shorter than size
+        ret = TF_ERR_DISKACCESS;
+    }
+    if (ret != 0) {   // no cluster left out of any chain, the error is kept
+        tf_copy_drop(&dst);
+    }
+    if (buffer != nullptr) {
+        tf_free(buffer);
+    }
+    return ret;
+}
+
+
+int tf_copy(const char* src_path, const char* dst_path)
+{
+    if (src_path == nullptr || dst_path == nullptr) {
+        return TF_ERR_PARAM;
+    }
+    return TF_PROF(TF_PROF_COPY, tf_copy_file(src_path, dst_path));
+}
@@ -0,0 +1,298 @@
+#include "tinyfat.h"
+#include "tinyfat_priv.h"
+
+#if TF_EXFAT_SUPPORTED
+
+#define TF_EXFAT_END          0x00   // end of dir
+#define TF_EXFAT_BITMAP       0x81   // allocation bitmap
+#define TF_EXFAT_FILE         0x85   // file, first entry of a set
+#define TF_EXFAT_STREAM       0xC0   // stream extension, second entry of a set
+#define TF_EXFAT_NAME         0xC1   // file name, 15 utf-16 chars
+#define TF_EXFAT_IN_USE       0x80   // entry type: in use
+#define TF_EXFAT_SECONDARY    0x40   // entry type: secondary entry of a set
+#define TF_EXFAT_NAME_PER_ENT 15     // utf-16 chars in a name entry
+#define TF_EXFAT_NO_FAT_CHAIN 0x02   // GeneralSecondaryFlags: NoFatChain
+
+
+/**
+ * @brief compare two utf-8 names, ascii chars are case insensitive
+ *
+ * @param a
+ * @param b
+ * @return bool
+ */
+static bool tf_exfat_name_match(const char* a, const char* b)
+{
+    while (*a != '\0' && toupper((uint8_t)*a) == toupper((uint8_t)*b)) {
+        a++;
+        b++;
+    }
+    return *a == *b;
+}
+
+
+/**
+ * @brief count the set bits of data
+ *
+ * @param data
+ * @param bits bit count, the high bits of the last byte are ignored
+ * @return uint32_t
+ */
+static uint32_t tf_exfat_count_bits(const uint8_t* data, uint32_t bits)
+{
+    uint32_t count = 0;
+
+    for (uint32_t i = 0; bits > 0; i++) {
+        uint8_t x = data[i];
+        if (bits < 8) {
+            x &= (1u << bits) - 1;
+        }
+        x = x - ((x >> 1) & 0x55);
+        x = (x & 0x33) + ((x >> 2) & 0x33);
+        count += (x + (x >> 4)) & 0x0F;
+        bits -= util_min2(bits, 8);
+    }
+    return count;
+}
+
+
+/**
+ * @brief parse the exfat boot sector in cache, find the allocation bitmap in root dir
+ *
+ * @param fs
+ * @param volume_ofs sector offset of the volume
+ * @return int 0-ok, other-fail
+ */
+int tf_exfat_mount(tf_fs_t* fs, uint32_t volume_ofs)
+{
+    uint8_t* bs = fs->cache;
+
+    fs->type           = TF_FS_EXFAT;
+    fs->sec_shift      = util_bytes2uint_le(bs + 108, 1);   // BytesPerSectorShift
+    fs->clus_sec_shift = util_bytes2uint_le(bs + 109, 1);   // SectorsPerClusterShift
+    fs->fat_num        = util_bytes2uint_le(bs + 110, 1);   // NumberOfFats
+
+    if (fs->sec_shift < 9 || fs->sec_shift > 12 || fs->clus_sec_shift > 25 - fs->sec_shift) {
+        return TF_ERR_SECTORSIZE;
+    }
+    fs->sec_size     = 1u << fs->sec_shift;
+    fs->clus_sec_num = 1u << fs->clus_sec_shift;
+    if (fs->sec_size > TF_SECTOR_SIZE_MAX || fs->sec_size != TF_SEC_SIZE(fs) ||
+        fs->clus_sec_num != TF_CLUS_SEC_NUM(fs)) {   // not the fixed geometry
+        return TF_ERR_SECTORSIZE;
+    }
+
+    fs->sec_num_total  = util_bytes2uint_le(bs + 76, 4) ? 0xFFFFFFFF
+                                                        : util_bytes2uint_le(bs + 72, 4);   // VolumeLength, 64 bits
+    fs->fat_sec_ofs    = volume_ofs + util_bytes2uint_le(bs + 80, 4);                       // FatOffset
+    fs->fat_sec_num    = util_bytes2uint_le(bs + 84, 4);                                    // FatLength
+    fs->dat_sec_ofs    = volume_ofs + util_bytes2uint_le(bs + 88, 4);                       // ClusterHeapOffset
+    fs->clus_num_total = util_bytes2uint_le(bs + 92, 4);                                    // ClusterCount
+    fs->root_clus      = util_bytes2uint_le(bs + 96, 4);   // FirstClusterOfRootDirectory
+    fs->free_clus_num  = TF_INVALID_FREE_COUNT;            // counted from the bitmap when needed
+    fs->next_free_clus = TF_INVALID_CLUSTER_ID;
+
+    tf_logger("[%s] exfat sec_size=%d\n", __func__, fs->sec_size);
+    tf_logger("[%s] exfat clus_sec_num=%d\n", __func__, fs->clus_sec_num);
+    tf_logger("[%s] exfat fat_sec_ofs=%d\n", __func__, fs->fat_sec_ofs);
+    tf_logger("[%s] exfat dat_sec_ofs=%d\n", __func__, fs->dat_sec_ofs);
+    tf_logger("[%s] exfat clus_num_total=%d\n", __func__, fs->clus_num_total);
+    tf_logger("[%s] exfat root_clus=%d\n", __func__, fs->root_clus);
+
+    if (fs->root_clus < 2 || fs->root_clus >= fs->clus_num_total + 2) {
+        return TF_ERR_NO_FAT32LBA;
+    }
+
+    // the allocation bitmap is in root dir
+    tf_dir_t root;
+    memset(&root, 0, sizeof(tf_dir_t));
+    root.fs         = fs;
+    root.attr       = TF_ATTR_DIRECTORY;
+    root.first_clus = fs->root_clus;
+    root.cur_clus   = fs->root_clus;
+
+    while (true) {
+        int ret = tf_item_data_fetch(&root);
+        if (ret != 0) {
+            return ret < 0 ? TF_ERR_DISKACCESS : TF_ERR_NO_FAT32LBA;
+        }
+
+        uint8_t* p = fs->cache + (root.cur_ofs & TF_SEC_MASK(fs));
+        root.cur_ofs += TF_DIRITEM_SIZE;
+
+        if (p[0] == TF_EXFAT_END) {
+            return TF_ERR_NO_FAT32LBA;
+        }
+        if (p[0] == TF_EXFAT_BITMAP && (p[1] & 0x01) == 0) {   // BitmapFlags: the first bitmap
+            fs->bitmap_clus = util_bytes2uint_le(p + 20, 4);   // FirstCluster
+            fs->bitmap_size = util_bytes2uint_le(p + 24, 4);   // DataLength, low 32 bits are enough
+            tf_logger("[%s] exfat bitmap_clus=%d\n", __func__, fs->bitmap_clus);
+            return 0;
+        }
+    }
+}
+
+
+/**
+ * @brief count free clusters by the allocation bitmap, sector by sector through cache
+ *
+ * @param fs
+ * @return int 0-ok, other-fail
+ */
+int tf_exfat_count_free(tf_fs_t* fs)
+{
+    tf_file_t bitmap;
+    memset(&bitmap, 0, sizeof(tf_file_t));
+    bitmap.fs         = fs;
+    bitmap.first_clus = fs->bitmap_clus;
+    bitmap.cur_clus   = fs->bitmap_clus;
+    bitmap.size       = fs->bitmap_size;
+
+    uint32_t bits_left = fs->clus_num_total;
+    uint32_t used      = 0;
+
+    while (bits_left > 0) {
+        if (tf_item_data_fetch(&bitmap) != 0) {
+            return TF_ERR_DISKACCESS;
+        }
+
+        uint32_t bits = util_min2(bits_left, (uint32_t)TF_SEC_SIZE(fs) << 3);
+        used += tf_exfat_count_bits(fs->cache, bits);
+        bits_left -= bits;
+        bitmap.cur_ofs += TF_SEC_SIZE(fs);
+    }
+
+    fs->free_clus_num = fs->clus_num_total - used;
+    return 0;
+}
+
+
+/**
+ * @brief make the search key of a name, ascii chars are upcased for the hash
+ *
+ * @param key
+ * @param name utf-8 name
+ */
+void tf_exfat_key_init(tf_exfat_key_t* key, const char* name)
+{
+    uint16_t hash = 0;
+    uint16_t len  = 0;
+    uint16_t c;
+    int      n;
+
+    key->name = name;
+    while ((n = tf_utf8_decode(name, &c)) > 0) {
+        c    = tf_char_upcase(c);
+        hash = ((hash & 1) ? 0x8000 : 0) + (hash >> 1) + (c & 0xFF);
+        hash = ((hash & 1) ? 0x8000 : 0) + (hash >> 1) + (c >> 8);
+        name += n;
+        len++;
+    }
+
+    key->hash = hash;
+    key->len  = len > 255 ? 0 : len;   // 0 never matches
+}
+
+
+/**
+ * @brief read next file entry set from dir
+ *
+ * with key, the sets whose NameLength or NameHash differ are skipped without assembling the name, only the
+ * matched one is returned
+ *
+ * @param dir
+ * @param item the item read from the dir, result value, changed even if not found
+ * @param key the name wanted, could be nullptr
+ * @return int 0-ok, positive-has end, TF_PENDING-read not done, the dir stops at the set being read, other
+ *             negtive-fail
+ */
+int tf_exfat_dir_read(tf_dir_t* dir, tf_item_t* item, const tf_exfat_key_t* key)
+{
+    tf_fs_t* fs          = dir->fs;
+    uint32_t dir_ofs_bak  = 0;       // where the current set starts
+    uint32_t dir_clus_bak = 0;
+    uint8_t  sec_left     = 0;       // secondary entries left in current set, 0 if not in a set
+    uint8_t  name_len     = 0;       // utf-16 length of name
+    uint8_t  name_got     = 0;       // utf-16 chars got
+    uint16_t pos          = 0;       // utf-8 bytes in item->name
+    bool     name_cut     = false;   // name longer than item->name
+
+    while (true) {
+        if (sec_left == 0) {
+            dir_ofs_bak  = dir->cur_ofs;
+            dir_clus_bak = dir->cur_clus;
+        }
+
+        int prefetch = tf_item_data_fetch(dir);
+        if (prefetch < 0) {   // read the set again next time
+            dir->cur_ofs  = dir_ofs_bak;
+            dir->cur_clus = dir_clus_bak;
+            return (prefetch == TF_PENDING) ? TF_PENDING : TF_ERR_DISKACCESS;
+        }
+        if (prefetch > 0) {
+            return 1;
+        }
+
+        uint8_t* p = fs->cache + (dir->cur_ofs & TF_SEC_MASK(fs));
+        dir->cur_ofs += TF_DIRITEM_SIZE;
+
+        if (p[0] == TF_EXFAT_END) {
+            return 1;
+        }
+        if (p[0] == TF_EXFAT_FILE) {   // a new set
+            sec_left = util_bytes2uint_le(p + 1, 1);   // SecondaryCount
+            name_len = 0;
+            memcpy(item->raw, p, TF_DIRITEM_SIZE);
+            item->raw_sec = fs->cache_sec_id;
+            item->raw_ofs = p - fs->cache;
+            item->attr    = util_bytes2uint_le(p + 4, 1);   // FileAttributes, low byte
+            continue;
+        }
+        if (sec_left == 0 || !TF_MASK_MATCH(p[0], TF_EXFAT_IN_USE | TF_EXFAT_SECONDARY)) {
+            sec_left = 0;   // not in a set, or unused/other primary entry, skip it
+            continue;
+        }
+        sec_left--;
+
+        if (p[0] == TF_EXFAT_STREAM) {
+            name_len      = util_bytes2uint_le(p + 3, 1);   // NameLength
+            uint16_t hash = util_bytes2uint_le(p + 4, 2);   // NameHash
+            if (name_len == 0 || (key != nullptr && (key->len != name_len || key->hash != hash))) {
+                sec_left = 0;   // not the wanted, skip the set
+                continue;
+            }
+            item->flags      = (p[1] & TF_EXFAT_NO_FAT_CHAIN) ? TF_ITEM_NO_FAT_CHAIN : 0;
+            item->first_clus = util_bytes2uint_le(p + 20, 4);   // FirstCluster
+            item->size       = util_bytes2uint_le(p + 28, 4) ? 0xFFFFFFFF
+                                                             : util_bytes2uint_le(p + 24, 4);   // DataLength, 64 bits
+            name_got         = 0;
+            pos              = 0;
+            name_cut         = false;
+        } else if (p[0] == TF_EXFAT_NAME && name_got < name_len) {
+            for (uint8_t i = 0; i < TF_EXFAT_NAME_PER_ENT && name_got < name_len; i++, name_got++) {
+                uint16_t end = name_cut ? pos : tf_utf8_append(item->name, pos, util_bytes2uint_le(p + 2 + 2 * i, 2));
+                name_cut     = (end == pos);   // the chars after a cut one are dropped too
+                pos          = end;
+            }
+            if (name_got < name_len) {
+                continue;
+            }
+
+            item->name[pos] = '\0';
+            if (key != nullptr && !tf_exfat_name_match(item->name, key->name)) {   // hash collision
+                sec_left = 0;
+                continue;
+            }
+
+            item->sfn[0]    = '\0';
+            item->cur_clus  = item->first_clus;
+            item->cur_ofs   = 0;
+            item->hint_clus = item->first_clus;
+            item->hint_ofs  = 0;
+            item->fs        = fs;
+            return 0;   // the rest secondary entries are skipped by next read
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,341 @@
+#include "tinyfat.h"
+#include "tinyfat_mem.h"
+#include "tinyfat_path.h"
+#include "tinyfat_priv.h"
+
+
+/**
+ * @brief add an extent to the run length histogram of report
+ *
+ * @param report could be nullptr
+ * @param run_len cluster count of the extent
+ */
+static void tf_frag_hist_add(tf_frag_report_t* report, uint32_t run_len)
+{
+    if (report != nullptr) {
+        uint8_t idx = 0;
+        while (run_len >> (idx + 1) && idx < TF_FRAG_HIST_NUM - 1) {
+            idx++;
+        }
+        report->run_hist[idx]++;
+    }
+}
+
+
+/**
+ * @brief walk a cluster chain, count clusters and extents
+ *
+ * @param fs
+ * @param first_clus
+ * @param report the extent lengths are added to its histogram, could be nullptr
+ * @param clus_num result value
+ * @param extent_num result value
+ * @return int 0-ok, other-fail
+ */
+static int tf_chain_walk(tf_fs_t* fs, uint32_t first_clus, tf_frag_report_t* report, uint32_t* clus_num,
+                         uint32_t* extent_num)
+{
+    uint32_t clus    = first_clus;
+    uint32_t run_len = 0;
+
+    *clus_num   = 0;
+    *extent_num = 0;
+
+    while (TF_CLUSTER_ID_VALID(clus) && clus >= 2) {
+        if (clus >= fs->clus_num_total + 2 || *clus_num >= fs->clus_num_total) {   // broken chain
+            return TF_ERR_DISKACCESS;
+        }
+
+        uint32_t next = tf_next_cluster(fs, clus);
+        (*clus_num)++;
+        run_len++;
+
+        if (next != clus + 1) {   // extent end
+            (*extent_num)++;
+            tf_frag_hist_add(report, run_len);
+            run_len = 0;
+        }
+        clus = next;
+    }
+    return clus == TF_INVALID_CLUSTER_ID ? TF_ERR_DISKACCESS : 0;
+}
+
+
+/**
+ * @brief count clusters and extents of an item, the exfat NoFatChain item is one extent without FAT access
+ *
+ * @param item
+ * @param report the extent lengths are added to its histogram, could be nullptr
+ * @param clus_num result value
+ * @param extent_num result value
+ * @return int 0-ok, other-fail
+ */
+static int tf_item_walk(tf_item_t* item, tf_frag_report_t* report, uint32_t* clus_num, uint32_t* extent_num)
+{
+    tf_fs_t* fs = item->fs;
+
+    if (item->flags & TF_ITEM_NO_FAT_CHAIN) {
+        *clus_num   = (item->size >> TF_CLUS_SHIFT(fs)) + ((item->size & TF_CLUS_MASK(fs)) != 0);
+        *extent_num = (*clus_num != 0);
+        if (*extent_num != 0) {
+            tf_frag_hist_add(report, *clus_num);
+        }
+        return 0;
+    }
+    return tf_chain_walk(fs, item->first_clus, report, clus_num, extent_num);
+}
+
+
+/**
+ * @brief add a file to the worst list of report if it is fragmented enough
+ *
+ * @param report
+ * @param path
+ * @param clus_num
+ * @param extent_num
+ */
+static void tf_frag_rank(tf_frag_report_t* report, const char* path, uint32_t clus_num, uint32_t extent_num)
+{
+    int pos = TF_FRAG_WORST_NUM;
+    while (pos > 0 && report->worst[pos - 1].extent_num < extent_num) {
+        pos--;
+    }
+    if (pos == TF_FRAG_WORST_NUM) {
+        return;
+    }
+
+    memmove(&report->worst[pos + 1], &report->worst[pos], (TF_FRAG_WORST_NUM - pos - 1) * sizeof(tf_frag_file_t));
+    strncpy(report->worst[pos].path, path, TF_PATH_LEN_MAX - 1);
+    report->worst[pos].path[TF_PATH_LEN_MAX - 1] = '\0';
+    report->worst[pos].clus_num                  = clus_num;
+    report->worst[pos].extent_num                = extent_num;
+}
+
+
+/**
+ * @brief scan a dir recursively
+ *
+ * @param dir
+ * @param path path of dir, the names of sub items are appended when scanning
+ * @param path_len length of path
+ * @param report
+ * @return int 0-ok, other-fail
+ */
+static int tf_frag_scan_dir(tf_dir_t* dir, char* path, uint16_t path_len, tf_frag_report_t* report)
+{
+    tf_item_t item;
+    char      name[TF_NAME_LEN_MAX];
+    int       ret;
+
+    while ((ret = tf_dir_read(dir, &item)) == 0) {
+        if (item.sfn[0] == '.' || TF_MASK_MATCH(item.attr, TF_ATTR_VOLUME_ID)) {   // ".", "..", volume label
+            continue;
+        }
+
+        // path of item: path + '/' + name
+        tf_item_get_name(&item, name);
+        uint16_t len = path_len;
+        if (len < TF_PATH_LEN_MAX - 1) {
+            path[len++] = '/';
+        }
+        for (const char* p = name; *p != '\0' && len < TF_PATH_LEN_MAX - 1; p++) {
+            path[len++] = *p;
+        }
+        path[len] = '\0';
+
+        if (TF_MASK_MATCH(item.attr, TF_ATTR_DIRECTORY)) {
+            ret = tf_frag_scan_dir(&item, path, len, report);
+        } else {
+            uint32_t clus_num, extent_num;
+            ret = tf_item_walk(&item, report, &clus_num, &extent_num);
+            if (ret == 0) {
+                report->file_num++;
+                report->clus_num += clus_num;
+                report->extent_num += extent_num;
+                if (extent_num > 1) {
+                    report->frag_file_num++;
+                    tf_frag_rank(report, path, clus_num, extent_num);
+                }
+            }
+        }
+        path[path_len] = '\0';
+
+        if (ret != 0) {
+            return ret;
+        }
+    }
+    return ret < 0 ? ret : 0;
+}
+
+
+/**
+ * @brief copy continuous sectors, several sectors a time with a buffer from heap, or one sector through cache
+ *
+ * @param fs
+ * @param src first sector to copy from
+ * @param dst first sector to copy to
+ * @param count sector count
+ * @return int 0-ok, other-fail
+ */
+static int tf_defrag_copy(tf_fs_t* fs, uint32_t src, uint32_t dst, uint32_t count)
+{
+    uint32_t sec_num = TF_FAT_SCAN_SEC_NUM;
+    uint8_t* buffer  = (uint8_t*)tf_malloc(sec_num << TF_SEC_SHIFT(fs));
+    int      ret     = 0;
+
+    if (buffer == nullptr) {   // no memory for a large buffer, use cache
+        for (uint32_t i = 0; i < count && ret == 0; i++) {
+            ret = tf_fs_disk_read(fs, src + i, TF_CACHE_DATA);
+            if (ret == 0) {
+                ret = tf_fs_disk_write(fs, dst + i, fs->cache);
+            }
+        }
+        return ret;
+    }
+
+    for (uint32_t i = 0; i < count && ret == 0; i += sec_num) {
+        uint32_t n = util_min2(sec_num, count - i);
+        ret        = tf_fs_disk_read_burst(fs, src + i, n, buffer);
+        if (ret == 0) {
+            ret = tf_fs_disk_write_burst(fs, dst + i, n, buffer);
+        }
+    }
+    tf_free(buffer);
+    return ret;
+}
+
+
+int tf_file_extents(tf_file_t* file, uint32_t* clus_num, uint32_t* extent_num)
+{
+    if (file == nullptr || clus_num == nullptr || extent_num == nullptr) {
+        return TF_ERR_PARAM;
+    }
+    return TF_PROF(TF_PROF_FRAG_SCAN, TF_IO_WAIT(tf_item_walk(file, nullptr, clus_num, extent_num)));
+}
+
+
+/**
+ * @brief scan the files under a dir, see `tf_frag_scan`
+ *
+ * @param path
+ * @param report
+ * @return int 0-ok, other-fail
+ */
+static int tf_frag_scan_path(const char* path, tf_frag_report_t* report)
+{
+    tf_dir_t dir;
+    int      ret = TF_IO_WAIT(tf_dir_open(path, &dir));
+    if (ret != 0) {
+        return ret;
+    }
+    if (!TF_MASK_MATCH(dir.attr, TF_ATTR_DIRECTORY)) {
+        return TF_ERR_PARAM;
+    }
+
+    static char scan_path[TF_PATH_LEN_MAX];
+    uint16_t    len = util_min2(strlen(path), TF_PATH_LEN_MAX - 1);
+    memcpy(scan_path, path, len);
+    while (len > 0 && scan_path[len - 1] == '/') {   // names are appended with '/'
+        len--;
+    }
+    scan_path[len] = '\0';
+
+    memset(report, 0, sizeof(tf_frag_report_t));
+    return TF_IO_WAIT(tf_frag_scan_dir(&dir, scan_path, len, report));
+}
+
+
+int tf_frag_scan(const char* path, tf_frag_report_t* report)
+{
+    if (path == nullptr || report == nullptr) {
+        return TF_ERR_PARAM;
+    }
+    return TF_PROF(TF_PROF_FRAG_SCAN, tf_frag_scan_path(path, report));
+}
+
+
+/**
+ * @brief move a file to a free run, see `tf_defrag_file`
+ *
+ * @param file
+ * @return int 0-ok, other-fail
+ */
+static int tf_defrag_chain(tf_file_t* file)
+{
+    if (file == nullptr) {
+        return TF_ERR_PARAM;
+    }
+    if (TF_MASK_MATCH(file->attr, TF_ATTR_DIRECTORY) || file->first_clus < 2) {
+        return TF_ERR_PARAM;
+    }
+
+    tf_fs_t* fs = file->fs;
+    if (fs->type != TF_FS_FAT32) {   // exfat is read only
+        return TF_ERR_NOT_SUPPORTED;
+    }
+
+    uint32_t clus_num, extent_num;
+    int      ret = tf_chain_walk(fs, file->first_clus, nullptr, &clus_num, &extent_num);
+    if (ret != 0 || extent_num <= 1) {
+        return ret;
+    }
+
+    uint32_t new_first = 0;
+    ret                = tf_fat_find_free_run(fs, clus_num, &new_first);
+    if (ret != 0) {
+        return ret;
+    }
+
+    // copy data to the new run, extent by extent
+    uint32_t clus = file->first_clus;
+    for (uint32_t i = 0; i < clus_num;) {
+        uint32_t run  = 1;
+        uint32_t next = tf_next_cluster(fs, clus);
+        while (next == clus + run && i + run < clus_num) {
+            next = tf_next_cluster(fs, clus + run);
+            run++;
+        }
+        ret = tf_defrag_copy(fs, TF_CLUS2SEC(fs, clus), TF_CLUS2SEC(fs, new_first + i), run << TF_CLUS_SEC_SHIFT(fs));
+        if (ret != 0) {
+            return TF_ERR_DISKACCESS;
+        }
+        i += run;
+        clus = next;
+    }
+
+    // link the new run, entries in one FAT sector are written together
+    for (uint32_t i = 0; i < clus_num; i++) {
+        ret = tf_fat_set(fs, new_first + i, (i == clus_num - 1) ? TF_FAT_EOC : new_first + i + 1);
+        if (ret != 0) {
+            return TF_ERR_DISKACCESS;
+        }
+    }
+    if (tf_fat_flush(fs) != 0 || tf_fs_free_count_add(fs, -(int32_t)clus_num) != 0) {
+        return TF_ERR_DISKACCESS;
+    }
+
+    // switch the dir item to the new run
+    uint32_t old_first = file->first_clus;
+    util_uint2bytes_le(file->raw + 20, new_first >> 16, 2);   // DIR_FstClusHI
+    util_uint2bytes_le(file->raw + 26, new_first, 2);         // DIR_FstClusLO
+    if (tf_item_raw_update(file) != 0) {
+        return TF_ERR_DISKACCESS;
+    }
+
+    // keep the file ptr, cur_clus is the cluster of the last byte read
+    file->first_clus = new_first;
+    file->cur_clus   = new_first + (file->cur_ofs == 0 ? 0 : (file->cur_ofs - 1) >> TF_CLUS_SHIFT(fs));
+    file->hint_clus  = new_first;
+
+    // free the old chain, it is not used by the dir item any more, each extent is discarded
+    if (tf_fat_free_chain(fs, old_first) != 0 || tf_fs_disk_flush(fs) != 0) {
+        return TF_ERR_DISKACCESS;
+    }
+    return 0;
+}
+
+
+int tf_defrag_file(tf_file_t* file)
+{
+    return TF_PROF(TF_PROF_DEFRAG, TF_IO_WAIT(tf_defrag_chain(file)));
+}
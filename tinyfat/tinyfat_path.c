@@ -1,17 +1,20 @@
 #include "tinyfat.h"
 #include "util_misc.h"
 
+#define TF_SFN_ANY  0x01   // sfn pattern byte: any byte, from '*'
+#define TF_SFN_CHAR 0x02   // sfn pattern byte: any byte but the padding space, from '?'
+
 // if name not accord with 8dot3, the sfn will be wrong
 int tf_name2sfn(const char* name, char* sfn)
 {
+    memset(sfn, ' ', 11);
+    sfn[11] = '\0';
+
     if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0) {
         memcpy(sfn, name, strlen(name));
         return 0;
     }
 
-    memset(sfn, ' ', 11);
-    sfn[11] = '\0';
-
     uint8_t i;
     for (i = 0; *name != '\0' && *name != '.' && i < 8; i++) {
         sfn[i] = toupper(*name++);
@@ -54,3 +57,154 @@ int tf_sfn2name(const char* sfn, char* name)
     }
     return 0;
 }
+
+
+/**
+ * @brief upcase a utf-16 char, only ascii chars are converted, the up-case table of exfat volume is not used
+ *
+ * @param c
+ * @return uint16_t
+ */
+uint16_t tf_char_upcase(uint16_t c)
+{
+    return (c >= 'a' && c <= 'z') ? c - 'a' + 'A' : c;
+}
+
+
+/**
+ * @brief decode a utf-8 char
+ *
+ * @param s
+ * @param c the utf-16 char, result value
+ * @return int bytes of the utf-8 char, 0 at the end of string
+ */
+int tf_utf8_decode(const char* s, uint16_t* c)
+{
+    const uint8_t* p = (const uint8_t*)s;
+
+    if (p[0] == 0) {
+        return 0;
+    }
+    if (p[0] < 0x80 || (p[1] & 0xC0) != 0x80) {   // ascii, or broken char taken as is
+        *c = p[0];
+        return 1;
+    }
+    if ((p[0] & 0xE0) == 0xC0) {
+        *c = ((p[0] & 0x1F) << 6) | (p[1] & 0x3F);
+        return 2;
+    }
+    if ((p[2] & 0xC0) != 0x80) {
+        *c = p[0];
+        return 1;
+    }
+    *c = ((p[0] & 0x0F) << 12) | ((p[1] & 0x3F) << 6) | (p[2] & 0x3F);
+    return 3;
+}
+
+
+/**
+ * @brief append a utf-16 char to name as utf-8, the char is dropped if there is no room
+ *
+ * @param name
+ * @param pos bytes of name
+ * @param c
+ * @return uint16_t new bytes of name, `pos` if cut: the chars after should be dropped too, the name ends at `pos`
+ */
+uint16_t tf_utf8_append(char* name, uint16_t pos, uint16_t c)
+{
+    uint8_t len = (c < 0x80) ? 1 : (c < 0x800) ? 2 : 3;
+    if (pos + len >= TF_NAME_LEN_MAX) {
+        return pos;   // cut, at the last whole char
+    }
+
+    if (len == 1) {
+        name[pos] = c;
+    } else if (len == 2) {
+        name[pos]     = 0xC0 | (c >> 6);
+        name[pos + 1] = 0x80 | (c & 0x3F);
+    } else {
+        name[pos]     = 0xE0 | (c >> 12);
+        name[pos + 1] = 0x80 | ((c >> 6) & 0x3F);
+        name[pos + 2] = 0x80 | (c & 0x3F);
+    }
+    return pos + len;
+}
+
+
+/**
+ * @brief compile a part of glob to the name or the extension field of sfn pattern
+ *
+ * @param s
+ * @param end end of the part in glob
+ * @param part the field of pattern, filled with spaces
+ * @param len field length
+ * @return int 0-ok, TF_ERR_FNAME_IVALID-could not be matched on sfn
+ */
+static int tf_sfn_pattern_part(const char* s, const char* end, char* part, uint8_t len)
+{
+    for (uint8_t i = 0; s < end; s++, i++) {
+        if (*s == '*') {
+            if (s + 1 != end) {   // only at the end of part
+                return TF_ERR_FNAME_IVALID;
+            }
+            memset(part + i, TF_SFN_ANY, len - i);
+            return 0;
+        }
+        if (i == len || *s == '/' || *s == '.') {   // a sfn has one '.', before the extension
+            return TF_ERR_FNAME_IVALID;
+        }
+        part[i] = (*s == '?') ? TF_SFN_CHAR : toupper(*s);
+    }
+    return 0;
+}
+
+
+/**
+ * @brief compile a glob to a pattern of the 11 bytes sfn field, so the dir items are matched before parsed
+ *
+ * the name and the extension are matched apart: `*` should be the last char of its part, it matches the rest of
+ * the part; `?` matches a char; a glob without '.' ending with `*` matches any extension; only the last '.' splits
+ * them, a glob with more is refused
+ *
+ * @param glob like "*.CFG" or "LOG????.TXT", case insensitive
+ * @param pattern result value, 11 bytes
+ * @return int 0-ok, TF_ERR_FNAME_IVALID-could not be matched on sfn
+ */
+int tf_sfn_pattern(const char* glob, char* pattern)
+{
+    const char* end = glob + strlen(glob);
+    const char* dot = strrchr(glob, '.');
+
+    memset(pattern, ' ', 11);
+    if (tf_sfn_pattern_part(glob, dot != nullptr ? dot : end, pattern, 8) != 0) {
+        return TF_ERR_FNAME_IVALID;
+    }
+    if (dot != nullptr) {
+        return tf_sfn_pattern_part(dot + 1, end, pattern + 8, 3);
+    }
+    if (end > glob && end[-1] == '*') {
+        memset(pattern + 8, TF_SFN_ANY, 3);
+    }
+    return 0;
+}
+
+
+/**
+ * @brief match the sfn field of a raw dir item with a pattern
+ *
+ * @param pattern made by `tf_sfn_pattern`
+ * @param sfn DIR_Name, 11 bytes
+ * @return bool
+ */
+bool tf_sfn_match(const char* pattern, const uint8_t* sfn)
+{
+    for (uint8_t i = 0; i < 11; i++) {
+        if (pattern[i] == TF_SFN_ANY) {
+            continue;
+        }
+        if ((pattern[i] == TF_SFN_CHAR) ? sfn[i] == ' ' : sfn[i] != (uint8_t)pattern[i]) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -2,5 +2,10 @@
 
 #include "util_misc.h"
 
-int tf_name2sfn(const char* name, char* sfn);
-int tf_sfn2name(const char* sfn, char* name);
+int      tf_name2sfn(const char* name, char* sfn);
+int      tf_sfn2name(const char* sfn, char* name);
+uint16_t tf_char_upcase(uint16_t c);
+int      tf_utf8_decode(const char* s, uint16_t* c);
+uint16_t tf_utf8_append(char* name, uint16_t pos, uint16_t c);
+int      tf_sfn_pattern(const char* glob, char* pattern);
+bool     tf_sfn_match(const char* pattern, const uint8_t* sfn);
@@ -0,0 +1,190 @@
+// tinyfat internal definitions, shared by the modules of tinyfat, not for users
+#pragma once
+
+#include "tinyfat.h"
+#include "util_queue.h"
+
+#define TF_SECTOR_SIZE_MAX        512
+#define TF_CACHE_NUM              (TF_SECTOR_SIZE_MAX / 4)   // FAT entries in a sector buffer
+#define TF_CLUSTER_ID_VALID(clus) (clus < 0x0FFFFFF8)
+#define TF_INVALID_SECTOR_ID      0xffffffff
+#define TF_INVALID_CLUSTER_ID     0xffffffff
+#define TF_PENDING_CLUSTER_ID     0xfffffffe   // FAT sector read is pending, see `tf_next_cluster`
+#define TF_INVALID_FREE_COUNT     0xffffffff
+#define TF_FSI_LEAD_SIG           0x41615252
+#define TF_FSI_STRUC_SIG          0x61417272
+#define TF_FAT_ENTRY_MASK         0x0FFFFFFF
+#define TF_FAT_FREE               0x00000000   // free cluster
+#define TF_FAT_EOC                0x0FFFFFFF   // end of cluster chain
+#define TF_ATTR_LFN               0x0F         // lfn item
+#define TF_ATTR_DELETED           0xE5         // deleted item
+#define TF_ATTR_EMPTY             0x00         // empty
+#define TF_LFN_LAST               0x40         // LDIR_Ord: the last lfn item of a name, stored first
+#define TF_LFN_ORD_MAX            20           // lfn items of a name at most
+#define TF_LFN_CHARS              13           // utf-16 chars in a lfn item
+#define TF_MASK_MATCH(attr, mask) (((attr) & (mask)) == (mask))
+#define TF_FS_FAT32               0
+#define TF_FS_EXFAT               1
+#define TF_CACHE_DATA             0            // file data, read once mostly, reused first
+#define TF_CACHE_META             1            // FAT, dir, boot sector and FSInfo
+#define TF_CACHE_HOT_MAX          (TF_CACHE_POOL_NUM * 3 / 4)   // max hot buffers, the others for new sectors
+
+// log2 of a constant pow of 2, up to 2^24
+#define TF_CONST_LOG2(n)                                                                                               \
+    ((n) >> 16 ? 16 + TF_CONST_LOG2_8((n) >> 16) : (n) >> 8 ? 8 + TF_CONST_LOG2_8((n) >> 8) : TF_CONST_LOG2_8(n))
+#define TF_CONST_LOG2_8(n)                                                                                             \
+    ((n) >> 7 ? 7 : (n) >> 6 ? 6 : (n) >> 5 ? 5 : (n) >> 4 ? 4 : (n) >> 3 ? 3 : (n) >> 2 ? 2 : (n) >> 1 ? 1 : 0)
+
+// disk geometry, constants if fixed at compile time, so the offset calculation is pure shift and mask
+#if TF_FIXED_SEC_SIZE && TF_FIXED_CLUS_SEC_NUM
+#define TF_SEC_SIZE(fs)       ((uint16_t)TF_FIXED_SEC_SIZE)
+#define TF_SEC_SHIFT(fs)      TF_CONST_LOG2(TF_FIXED_SEC_SIZE)
+#define TF_CLUS_SEC_NUM(fs)   ((uint32_t)TF_FIXED_CLUS_SEC_NUM)
+#define TF_CLUS_SEC_SHIFT(fs) TF_CONST_LOG2(TF_FIXED_CLUS_SEC_NUM)
+#else
+#define TF_SEC_SIZE(fs)       ((fs)->sec_size)
+#define TF_SEC_SHIFT(fs)      ((fs)->sec_shift)
+#define TF_CLUS_SEC_NUM(fs)   ((fs)->clus_sec_num)
+#define TF_CLUS_SEC_SHIFT(fs) ((fs)->clus_sec_shift)
+#endif
+#define TF_SEC_MASK(fs)       ((uint32_t)TF_SEC_SIZE(fs) - 1)
+#define TF_CLUS_SHIFT(fs)     (TF_SEC_SHIFT(fs) + TF_CLUS_SEC_SHIFT(fs))
+#define TF_CLUS_SIZE(fs)      ((uint32_t)1 << TF_CLUS_SHIFT(fs))
+#define TF_CLUS_MASK(fs)      (TF_CLUS_SIZE(fs) - 1)
+#define TF_CLUS2SEC(fs, clus) ((fs)->dat_sec_ofs + (((clus) - 2) << TF_CLUS_SEC_SHIFT(fs)))   // first sector of cluster
+
+// run an operation which could not resume, the pending reads in it are asked again until done
+#define TF_IO_WAIT(op)        (tf_io_wait_begin(), tf_io_wait_end(op))
+
+// time an operation for a profile point, see `tf_prof_start`
+#define TF_PROF(point, op)    (tf_prof_begin(), tf_prof_end(point, op))
+
+
+typedef struct {
+    tf_fs_t* fs;                             // owner volume, nullptr if free
+    uint32_t sec_id;                         // sector id of data
+    uint32_t stamp;                          // last access, for LRU
+    uint8_t  kind;                           // TF_CACHE_DATA or TF_CACHE_META
+    bool     hot;                            // meta sector accessed again after loaded, kept longer
+    bool     dirty;                          // modified FAT sector, written to all FATs before reuse
+    bool     pinned;                         // borrowed by `tf_file_read_ptr`, not reused
+    uint32_t data[TF_SECTOR_SIZE_MAX / 4];   // 4 bytes aligned, for FAT entries
+} tf_cache_buf_t;
+
+
+typedef struct tf_snap_t tf_snap_t;
+
+struct tf_fs_t {
+    uint8_t              device;           // device id
+    const tf_disk_ops_t* ops;              // block device ops
+    char                 label;            // label, '\0' mean not used
+    uint8_t              type;             // TF_FS_FAT32 or TF_FS_EXFAT
+    uint16_t             sec_size;         // BS: sector size
+    uint32_t             clus_sec_num;     // BS: sector count of a cluster
+    uint8_t              sec_shift;        // log2 of sec_size
+    uint8_t              clus_sec_shift;   // log2 of clus_sec_num
+    uint8_t              fat_num;          // BS: FAT count
+    uint32_t             sec_num_total;    // BS: sector count of volume
+    uint32_t             fat_sec_num;      // BS: sector count of a FAT
+    uint32_t             clus_num_total;   // cluster count of DATA area
+    uint32_t             free_clus_num;    // FSInfo: FSI_Free_Count, TF_INVALID_FREE_COUNT if unknown
+    uint32_t             next_free_clus;   // FSInfo: FSI_Nxt_Free
+    uint32_t             fat_sec_ofs;      // sector offset of FAT area in all DISK
+    uint32_t             dat_sec_ofs;      // sector offset of DATA area in DISK
+    uint32_t             root_clus;        // BS: first cluster of root dir
+    uint32_t             fsinfo_sec_id;    // sector id of FSInfo, TF_INVALID_SECTOR_ID if none
+    bool                 fsinfo_dirty;     // free count changed, FSInfo is written at unmount
+#if TF_EXFAT_SUPPORTED
+    uint32_t             bitmap_clus;      // exfat: first cluster of allocation bitmap
+    uint32_t             bitmap_size;      // exfat: byte size of allocation bitmap
+#endif
+    uint8_t*             cache;            // data of the sector last read, in cache_buf
+    uint32_t             cache_sec_id;     // cache sector id
+    tf_cache_buf_t*      cache_buf;        // buffer of cache, valid only if it is still owned by the fs
+    tf_cache_buf_t*      pinned_buf;       // buffer borrowed by `tf_file_read_ptr`
+    uint32_t*            fatcache;         // FAT window, next cluster id, in fatcache_buf
+    uint32_t             fatcache_start;   // fatcache start cluster id
+    tf_cache_buf_t*      fatcache_buf;     // buffer of fatcache, valid only if it is still owned by the fs
+    uint8_t              cache_weight;     // share of the cache pool, see `tf_cache_set_weight`
+    uint8_t              cache_num;        // buffers of the cache pool owned
+    tf_snap_t*           snap;             // warm-start snapshot, nullptr if the device keeps none
+    util_queue_node_t    qnode;
+};
+
+
+uint32_t tf_next_cluster(tf_fs_t* fs, uint32_t clus_id);
+int      tf_fat_set(tf_fs_t* fs, uint32_t clus_id, uint32_t value);
+int      tf_fat_flush(tf_fs_t* fs);
+int      tf_fat_find_free_run(tf_fs_t* fs, uint32_t num, uint32_t* first);
+int      tf_fat_free_chain(tf_fs_t* fs, uint32_t clus_id);
+int      tf_fat_alloc(tf_fs_t* fs, uint32_t* last, uint32_t num, uint32_t* first);
+int      tf_fs_free_count_add(tf_fs_t* fs, int32_t num);
+int      tf_fs_count_free(tf_fs_t* fs);
+void     tf_io_wait_begin(void);
+int      tf_io_wait_end(int ret);
+int      tf_fs_disk_read_op(tf_fs_t* fs, uint32_t sec_id, uint32_t count, uint8_t* buffer);
+int      tf_fs_disk_read(tf_fs_t* fs, uint32_t sec_id, uint8_t kind);
+int      tf_fs_disk_read_burst(tf_fs_t* fs, uint32_t sec_id, uint32_t count, uint8_t* buffer);
+int      tf_fs_disk_write(tf_fs_t* fs, uint32_t sec_id, const uint8_t* data);
+int      tf_fs_disk_write_burst(tf_fs_t* fs, uint32_t sec_id, uint32_t count, const uint8_t* buffer);
+int      tf_fs_disk_flush(tf_fs_t* fs);
+int      tf_fs_discard(tf_fs_t* fs, uint32_t first_clus, uint32_t clus_num);
+int      tf_item_data_fetch(tf_item_t* item);
+int      tf_dir_read_match(tf_dir_t* dir, const char* pattern, bool dirs, tf_item_t* item, bool* matched);
+int      tf_cache_get(tf_fs_t* fs, uint32_t sec_id, uint8_t kind, const tf_cache_buf_t* keep, tf_cache_buf_t** buf);
+void     tf_cache_update(tf_fs_t* fs, uint32_t sec_id, uint32_t count, const uint8_t* data);
+void     tf_cache_drop(tf_fs_t* fs, uint32_t sec_id, uint32_t count);
+int      tf_cache_flush(tf_fs_t* fs);
+void     tf_cache_weight(tf_fs_t* fs, uint8_t weight);
+int      tf_item_raw_update(tf_item_t* item);
+void     tf_item_stamp(uint8_t* raw, bool create);
+int      tf_item_create(const char* path, tf_item_t* item);
+int      tf_append_commit(tf_append_t* ap, uint32_t size, bool early);
+void     tf_snap_load(tf_fs_t* fs, uint32_t vol_id);
+int      tf_snap_save(tf_fs_t* fs);
+bool     tf_snap_find(tf_fs_t* fs, const char* path, tf_item_t* item);
+void     tf_snap_add(tf_fs_t* fs, const char* path, const tf_item_t* item);
+void     tf_snap_drop(tf_fs_t* fs, uint32_t sec_id, uint32_t count);
+void     tf_snap_stamp(tf_fs_t* fs, uint32_t free_count);
+#if TF_TRACE_SUPPORTED
+void     tf_trace_record(const tf_fs_t* fs, uint32_t sec_id, uint32_t count, uint8_t op);
+#else
+#define tf_trace_record(fs, sec_id, count, op)
+#endif
+#if TF_PROF_SUPPORTED
+void     tf_prof_begin(void);
+int      tf_prof_end(uint8_t point, int ret);
+#else
+#define tf_prof_begin() ((void)0)
+#define tf_prof_end(point, ret) (ret)
+#endif
+
+typedef struct {
+    char     sfn[TF_SFN_LEN];         // sfn of the name wanted, compared with DIR_Name
+    bool     sfn_ok;                  // name is 8.3, it has a sfn
+#if TF_LFN_SUPPORTTED
+    uint16_t fold[TF_NAME_LEN_MAX];   // upcased utf-16 chars of the name wanted, compared with the lfn items
+    uint8_t  len;                     // utf-16 length of name
+#endif
+} tf_name_key_t;
+
+#if TF_LFN_SUPPORTTED
+typedef struct {
+    uint16_t len;    // utf-16 length of the long name, 0 if no valid lfn items, or not the wanted
+    uint8_t  next;   // LDIR_Ord of the next lfn item wanted, 0 if all got
+    uint8_t  sum;    // LDIR_Chksum of the lfn items
+} tf_lfn_run_t;
+#endif
+
+#if TF_EXFAT_SUPPORTED
+typedef struct {
+    const char* name;   // name wanted
+    uint16_t    hash;   // exfat name hash of name
+    uint8_t     len;    // utf-16 length of name
+} tf_exfat_key_t;
+
+int  tf_exfat_mount(tf_fs_t* fs, uint32_t volume_ofs);
+int  tf_exfat_count_free(tf_fs_t* fs);
+void tf_exfat_key_init(tf_exfat_key_t* key, const char* name);
+int  tf_exfat_dir_read(tf_dir_t* dir, tf_item_t* item, const tf_exfat_key_t* key);
+#endif
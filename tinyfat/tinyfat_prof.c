@@ -0,0 +1,126 @@
+#include "tinyfat.h"
+#include "tinyfat_priv.h"
+
+#if TF_PROF_SUPPORTED
+
+typedef uint32_t (*tf_prof_clock_t)(void* ctx);
+
+static tf_prof_clock_t  prof_clock;                      // nullptr if not profiling
+static void*            prof_ctx;                        // given to prof_clock
+static uint8_t          prof_depth;                      // points entered, the ones beyond the stack are not timed
+static uint32_t         prof_stack[TF_PROF_DEPTH_MAX];   // start time of the points entered
+static tf_prof_report_t prof_report;                     //
+
+static const char* const prof_names[TF_PROF_POINT_NUM] = {
+    "mount",      "unmount",      "statfs", "item_open", "dir_read",  "file_read", "file_delete", "file_truncate",
+    "append",     "copy",         "walk",   "check",     "frag_scan", "defrag",    "disk_read",   "disk_write",
+    "disk_flush", "disk_discard",
+};
+
+
+/**
+ * @brief enter a profile point, see `TF_PROF`
+ */
+void tf_prof_begin(void)
+{
+    if (prof_clock == nullptr) {
+        return;
+    }
+    if (prof_depth < TF_PROF_DEPTH_MAX) {
+        prof_stack[prof_depth] = prof_clock(prof_ctx);
+    }
+    prof_depth++;
+}
+
+
+/**
+ * @brief leave the profile point entered by `tf_prof_begin`, its time is added to the histogram
+ *
+ * @param point TF_PROF_*
+ * @param ret result of the operation
+ * @return int ret
+ */
+int tf_prof_end(uint8_t point, int ret)
+{
+    if (prof_clock == nullptr || prof_depth == 0) {
+        return ret;
+    }
+    prof_depth--;
+    if (prof_depth >= TF_PROF_DEPTH_MAX) {
+        return ret;
+    }
+
+    uint32_t         time = prof_clock(prof_ctx) - prof_stack[prof_depth];
+    tf_prof_point_t* pt   = &prof_report.point[point];
+    uint8_t          idx  = 0;
+    while (time >> (idx + 1) && idx < TF_PROF_HIST_NUM - 1) {
+        idx++;
+    }
+    pt->hist[idx]++;
+    pt->count++;
+    pt->total += time;
+    pt->max = util_max2(pt->max, time);
+    return ret;
+}
+
+
+int tf_prof_start(uint32_t (*clock)(void* ctx), void* ctx)
+{
+    if (clock == nullptr) {
+        return TF_ERR_PARAM;
+    }
+    if (prof_clock != nullptr) {   // profiling already
+        return TF_ERR_PARAM;
+    }
+
+    memset(&prof_report, 0, sizeof(prof_report));
+    prof_ctx   = ctx;
+    prof_depth = 0;
+    prof_clock = clock;
+    return 0;
+}
+
+
+int tf_prof_stop(void)
+{
+    if (prof_clock == nullptr) {
+        return TF_ERR_PARAM;
+    }
+    prof_clock = nullptr;
+    return 0;
+}
+
+
+int tf_prof_get(tf_prof_report_t* report)
+{
+    if (report == nullptr) {
+        return TF_ERR_PARAM;
+    }
+    memcpy(report, &prof_report, sizeof(prof_report));
+    return 0;
+}
+
+
+void tf_prof_print(const tf_prof_report_t* report)
+{
+    if (report == nullptr) {
+        return;
+    }
+
+    for (int i = 0; i < TF_PROF_POINT_NUM; i++) {
+        const tf_prof_point_t* pt = &report->point[i];
+        if (pt->count == 0) {
+            continue;
+        }
+        util_printf("%-14s count %u, avg %u, max %u |", prof_names[i], pt->count, (uint32_t)(pt->total / pt->count),
+                    pt->max);
+        for (int k = 0; k < TF_PROF_HIST_NUM; k++) {   // lower bound of bucket: count
+            if (pt->hist[k] != 0) {
+                util_printf(" %u:%u", (k == 0) ? 0 : 1u << k, pt->hist[k]);
+            }
+        }
+        util_printf("\n");
+    }
+}
+
+#endif
@@ -0,0 +1,216 @@
+#include "tinyfat.h"
+#include "tinyfat_mem.h"
+#include "tinyfat_priv.h"
+
+
+static int tf_ramdisk_read_multi(void* ctx, uint32_t sec_id, uint32_t count, uint16_t sec_size, uint8_t* data)
+{
+    tf_ramdisk_t* rd  = (tf_ramdisk_t*)ctx;
+    uint64_t      ofs = (uint64_t)sec_id * sec_size;
+    uint64_t      len = (uint64_t)count * sec_size;
+
+    if (ofs + len > rd->size) {
+        return TF_ERR_DISKACCESS;
+    }
+    memcpy(data, rd->data + ofs, len);
+    return 0;
+}
+
+
+static int tf_ramdisk_read(void* ctx, uint32_t sec_id, uint16_t sec_size, uint8_t* data)
+{
+    return tf_ramdisk_read_multi(ctx, sec_id, 1, sec_size, data);
+}
+
+
+static int tf_ramdisk_write_multi(void* ctx, uint32_t sec_id, uint32_t count, uint16_t sec_size, const uint8_t* data)
+{
+    tf_ramdisk_t* rd  = (tf_ramdisk_t*)ctx;
+    uint64_t      ofs = (uint64_t)sec_id * sec_size;
+    uint64_t      len = (uint64_t)count * sec_size;
+
+    if (ofs + len > rd->size) {
+        return TF_ERR_DISKACCESS;
+    }
+    memcpy(rd->data + ofs, data, len);
+    return 0;
+}
+
+
+static int tf_ramdisk_write(void* ctx, uint32_t sec_id, uint16_t sec_size, const uint8_t* data)
+{
+    return tf_ramdisk_write_multi(ctx, sec_id, 1, sec_size, data);
+}
+
+
+int tf_ramdisk_open(tf_ramdisk_t* rd, uint8_t* data, uint32_t size, bool read_only)
+{
+    if (rd == nullptr || data == nullptr) {
+        return TF_ERR_PARAM;
+    }
+
+    memset(rd, 0, sizeof(tf_ramdisk_t));
+    rd->data           = data;
+    rd->size           = size;
+    rd->read_only      = read_only;
+    rd->ops.read       = tf_ramdisk_read;
+    rd->ops.read_multi = tf_ramdisk_read_multi;
+    if (!read_only) {
+        rd->ops.write       = tf_ramdisk_write;
+        rd->ops.write_multi = tf_ramdisk_write_multi;
+    }
+    rd->ops.ctx = rd;
+    return 0;
+}
+
+
+/**
+ * @brief find the entry of a sector in the index of overlay, or the empty entry where it goes
+ *
+ * @param ov
+ * @param sec_id
+ * @return uint32_t* the entry: sector id + 1, slot
+ */
+static uint32_t* tf_overlay_lookup(tf_overlay_t* ov, uint32_t sec_id)
+{
+    uint32_t mask = ov->index_cap - 1;
+    uint32_t pos  = (sec_id * 2654435761u) & mask;   // Knuth multiplicative hash
+
+    while (ov->index[pos * 2] != 0 && ov->index[pos * 2] != sec_id + 1) {   // never full, cap > slot_num
+        pos = (pos + 1) & mask;
+    }
+    return &ov->index[pos * 2];
+}
+
+
+/**
+ * @brief read sectors of overlay, the sectors in pool are copied, the runs of others are read from base together
+ */
+static int tf_overlay_read_multi(void* ctx, uint32_t sec_id, uint32_t count, uint16_t sec_size, uint8_t* data)
+{
+    tf_overlay_t*        ov   = (tf_overlay_t*)ctx;
+    const tf_disk_ops_t* base = ov->base;
+
+    if (sec_size != ov->sec_size) {
+        return TF_ERR_SECTORSIZE;
+    }
+    for (uint32_t i = 0; i < count;) {
+        uint32_t* ent = tf_overlay_lookup(ov, sec_id + i);
+        if (ent[0] != 0) {
+            memcpy(data + i * sec_size, ov->pool + ent[1] * sec_size, sec_size);
+            i++;
+            continue;
+        }
+
+        uint32_t run = 1;   // base sectors not in pool
+        while (base->read_multi != nullptr && i + run < count && tf_overlay_lookup(ov, sec_id + i + run)[0] == 0) {
+            run++;
+        }
+        int ret = (run > 1) ? base->read_multi(base->ctx, sec_id + i, run, sec_size, data + i * sec_size)
+                            : base->read(base->ctx, sec_id + i, sec_size, data + i * sec_size);
+        if (ret != 0) {   // pending too, all the sectors are asked again
+            return ret;
+        }
+        i += run;
+    }
+    return 0;
+}
+
+
+static int tf_overlay_read(void* ctx, uint32_t sec_id, uint16_t sec_size, uint8_t* data)
+{
+    return tf_overlay_read_multi(ctx, sec_id, 1, sec_size, data);
+}
+
+
+/**
+ * @brief write sectors of overlay to pool, a sector written again takes its slot again
+ */
+static int tf_overlay_write_multi(void* ctx, uint32_t sec_id, uint32_t count, uint16_t sec_size, const uint8_t* data)
+{
+    tf_overlay_t* ov = (tf_overlay_t*)ctx;
+
+    if (sec_size != ov->sec_size) {
+        return TF_ERR_SECTORSIZE;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t* ent = tf_overlay_lookup(ov, sec_id + i);
+        if (ent[0] == 0) {
+            if (ov->used_num == ov->slot_num) {   // the sectors before are written, as a disk fails midway
+                return TF_ERR_NO_SPACE;
+            }
+            ent[0] = sec_id + i + 1;
+            ent[1] = ov->used_num++;
+        }
+        memcpy(ov->pool + ent[1] * sec_size, data + i * sec_size, sec_size);
+    }
+    return 0;
+}
+
+
+static int tf_overlay_write(void* ctx, uint32_t sec_id, uint16_t sec_size, const uint8_t* data)
+{
+    return tf_overlay_write_multi(ctx, sec_id, 1, sec_size, data);
+}
+
+
+static int tf_overlay_flush(void* ctx)
+{
+    util_unused(ctx);
+    return 0;   // the pool is memory
+}
+
+
+int tf_overlay_open(tf_overlay_t* ov, const tf_disk_ops_t* base, uint8_t* pool, uint32_t size, uint16_t sec_size)
+{
+    if (ov == nullptr || base == nullptr || base->read == nullptr || pool == nullptr || sec_size == 0) {
+        return TF_ERR_PARAM;
+    }
+
+    memset(ov, 0, sizeof(tf_overlay_t));
+    ov->base      = base;
+    ov->pool      = pool;
+    ov->sec_size  = sec_size;
+    ov->slot_num  = size / sec_size;
+    ov->index_cap = 2;
+    while (ov->index_cap < ov->slot_num * 2) {   // half full at most
+        ov->index_cap <<= 1;
+    }
+    ov->index = (uint32_t*)tf_malloc(ov->index_cap * 2 * sizeof(uint32_t));
+    if (ov->index == nullptr) {
+        return TF_ERR_NO_MEM;
+    }
+    memset(ov->index, 0, ov->index_cap * 2 * sizeof(uint32_t));
+
+    ov->ops.read        = tf_overlay_read;
+    ov->ops.read_multi  = tf_overlay_read_multi;
+    ov->ops.write       = tf_overlay_write;
+    ov->ops.write_multi = tf_overlay_write_multi;
+    ov->ops.flush       = tf_overlay_flush;
+    ov->ops.io_align    = base->io_align;
+    ov->ops.io_size     = base->io_size;
+    ov->ops.ctx         = ov;
+    return 0;
+}
+
+
+int tf_overlay_reset(tf_overlay_t* ov)
+{
+    if (ov == nullptr || ov->index == nullptr) {
+        return TF_ERR_PARAM;
+    }
+    memset(ov->index, 0, ov->index_cap * 2 * sizeof(uint32_t));
+    ov->used_num = 0;
+    return 0;
+}
+
+
+int tf_overlay_close(tf_overlay_t* ov)
+{
+    if (ov == nullptr || ov->index == nullptr) {
+        return TF_ERR_PARAM;
+    }
+    tf_free(ov->index);
+    ov->index = nullptr;
+    return 0;
+}
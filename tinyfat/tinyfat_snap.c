@@ -0,0 +1,298 @@
+#include "tinyfat.h"
+#include "tinyfat_mem.h"
+#include "tinyfat_priv.h"
+
+#define TF_SNAP_MAGIC   0x4e534654   // "TFSN"
+#define TF_SNAP_VERSION 2            //
+
+typedef struct {
+    char      path[TF_PATH_LEN_MAX];   // path given to `tf_item_open`, compared as is
+    tf_item_t item;                    // as opened, TF_ITEM_NO_FAT_CHAIN if the file is one extent
+    uint32_t  fat_crc;                 // CRC-32 of the FAT sectors of the extent, TF_ITEM_NO_FAT_CHAIN only
+} tf_snap_item_t;
+
+// kept by the device as is, only read back by the same build, so the items are not encoded
+typedef struct {
+    uint32_t magic;           //
+    uint16_t version;         //
+    uint16_t item_size;       // sizeof(tf_snap_item_t), a snapshot of another build is not loaded
+    uint32_t item_num;        // items following the head
+    uint32_t vol_id;          // BS_VolID
+    uint32_t fsi_free;        // free count in FSInfo as the mount sees it, TF_INVALID_FREE_COUNT if not trusted
+    uint32_t fsi_next;        // FSI_Nxt_Free
+    uint32_t free_clus_num;   // free count known at save, maybe counted after mount
+} tf_snap_head_t;
+
+struct tf_snap_t {
+    tf_snap_head_t head;                      // saved
+    tf_snap_item_t items[TF_SNAP_ITEM_NUM];   // saved, head.item_num ones
+    bool           kept;                      // the device keeps a snapshot, voided before the first write
+};
+
+
+/**
+ * @brief CRC-32 of the sectors of the first FAT holding the entries of an extent, so a FAT changed by another host
+ *        is found
+ *
+ * @param fs
+ * @param first_clus first cluster of the extent
+ * @param clus_num cluster count of the extent
+ * @param crc result value
+ * @return int 0-ok, other-fail
+ */
+static int tf_snap_fat_crc(tf_fs_t* fs, uint32_t first_clus, uint32_t clus_num, uint32_t* crc)
+{
+    uint32_t sec_id = fs->fat_sec_ofs + ((first_clus * 4) >> TF_SEC_SHIFT(fs));
+    uint32_t last   = fs->fat_sec_ofs + (((first_clus + clus_num - 1) * 4) >> TF_SEC_SHIFT(fs));
+    uint32_t value  = 0xFFFFFFFF;
+
+    for (; sec_id <= last; sec_id++) {
+        if (tf_fs_disk_read(fs, sec_id, TF_CACHE_META) != 0) {
+            return TF_ERR_DISKACCESS;
+        }
+        for (uint32_t i = 0; i < TF_SEC_SIZE(fs); i++) {   // reflected, poly 0x04C11DB7
+            value ^= fs->cache[i];
+            for (int k = 0; k < 8; k++) {
+                value = (value >> 1) ^ (0xEDB88320 & (0 - (value & 1)));
+            }
+        }
+    }
+    *crc = ~value;
+    return 0;
+}
+
+
+/**
+ * @brief an item of the snapshot is the same on disk: its dir item, and the FAT of its extent if it is read without
+ *        FAT
+ *
+ * @param fs
+ * @param si
+ * @return bool true-the same
+ */
+static bool tf_snap_verify(tf_fs_t* fs, const tf_snap_item_t* si)
+{
+    const tf_item_t* item = &si->item;
+    if (item->raw_sec < fs->dat_sec_ofs || item->raw_ofs > TF_SEC_SIZE(fs) - TF_DIRITEM_SIZE) {
+        return false;
+    }
+    if (tf_fs_disk_read(fs, item->raw_sec, TF_CACHE_META) != 0 ||
+        memcmp(fs->cache + item->raw_ofs, item->raw, TF_DIRITEM_SIZE) != 0) {
+        return false;
+    }
+    if (!(item->flags & TF_ITEM_NO_FAT_CHAIN)) {   // the FAT is read as the file is
+        return true;
+    }
+
+    uint32_t num = (item->size >> TF_CLUS_SHIFT(fs)) + ((item->size & TF_CLUS_MASK(fs)) != 0);
+    uint32_t crc;
+    if (num == 0 || item->first_clus < 2 || item->first_clus - 2 + num > fs->clus_num_total) {
+        return false;
+    }
+    return tf_snap_fat_crc(fs, item->first_clus, num, &crc) == 0 && crc == si->fat_crc;
+}
+
+
+/**
+ * @brief load the snapshot kept by device at mount, a snapshot not matching the volume is dropped, the paths are
+ *        recorded from empty then; each item is checked against disk, the ones changed are dropped, and the free
+ *        count saved is not used then
+ *
+ * @param fs mounted FAT32 volume, FSInfo read
+ * @param vol_id BS_VolID
+ */
+void tf_snap_load(tf_fs_t* fs, uint32_t vol_id)
+{
+    const tf_disk_ops_t* ops = fs->ops;
+    if (ops->snap_read == nullptr || ops->snap_write == nullptr) {   // a snapshot kept should be voided at write
+        return;
+    }
+    tf_snap_t* snap = (tf_snap_t*)tf_malloc(sizeof(tf_snap_t));
+    if (snap == nullptr) {   // cold start
+        return;
+    }
+    fs->snap = snap;
+
+    tf_snap_head_t* head = &snap->head;
+    uint32_t        max  = sizeof(tf_snap_head_t) + sizeof(snap->items);
+    int             size = ops->snap_read(ops->ctx, (uint8_t*)snap, max);
+    snap->kept = (size > 0);
+    if (size < (int)sizeof(tf_snap_head_t) || head->magic != TF_SNAP_MAGIC || head->version != TF_SNAP_VERSION ||
+        head->item_size != sizeof(tf_snap_item_t) || head->item_num > TF_SNAP_ITEM_NUM ||
+        size < (int)(sizeof(tf_snap_head_t) + head->item_num * sizeof(tf_snap_item_t)) || head->vol_id != vol_id ||
+        head->fsi_free != fs->free_clus_num || head->fsi_next != fs->next_free_clus) {
+        head->item_num      = 0;
+        head->free_clus_num = TF_INVALID_FREE_COUNT;
+    }
+
+    for (uint32_t i = 0; i < head->item_num;) {
+        snap->items[i].item.fs        = fs;
+        snap->items[i].item.pend_path = nullptr;
+        if (!tf_snap_verify(fs, &snap->items[i])) {   // changed by another host
+            memcpy(&snap->items[i], &snap->items[--head->item_num], sizeof(tf_snap_item_t));
+            head->free_clus_num = TF_INVALID_FREE_COUNT;
+            continue;
+        }
+        i++;
+    }
+    head->magic     = TF_SNAP_MAGIC;
+    head->version   = TF_SNAP_VERSION;
+    head->item_size = sizeof(tf_snap_item_t);
+    head->vol_id    = vol_id;
+    tf_snap_stamp(fs, fs->free_clus_num);
+    if (fs->free_clus_num == TF_INVALID_FREE_COUNT) {   // counted last mount
+        fs->free_clus_num = head->free_clus_num;
+    }
+}
+
+
+/**
+ * @brief mark the files of snapshot in one extent, then give the snapshot to device, at unmount
+ *
+ * @param fs
+ * @return int 0-ok, other-fail
+ */
+int tf_snap_save(tf_fs_t* fs)
+{
+    tf_snap_t* snap = fs->snap;
+    if (snap == nullptr) {
+        return 0;
+    }
+
+    for (uint32_t i = 0; i < snap->head.item_num; i++) {
+        tf_item_t* item = &snap->items[i].item;
+        uint32_t   num  = (item->size >> TF_CLUS_SHIFT(fs)) + ((item->size & TF_CLUS_MASK(fs)) != 0);
+        if (TF_MASK_MATCH(item->attr, TF_ATTR_DIRECTORY) || num == 0 || (item->flags & TF_ITEM_NO_FAT_CHAIN)) {
+            continue;
+        }
+
+        uint32_t clus = item->first_clus;
+        uint32_t k    = 1;
+        while (k < num && tf_next_cluster(fs, clus) == clus + 1) {
+            clus++;
+            k++;
+        }
+        uint32_t next = tf_next_cluster(fs, clus);
+        if (next == TF_INVALID_CLUSTER_ID) {
+            return TF_ERR_DISKACCESS;
+        }
+        if (k == num && !TF_CLUSTER_ID_VALID(next) &&   // exactly the clusters of size, continuous
+            tf_snap_fat_crc(fs, item->first_clus, num, &snap->items[i].fat_crc) == 0) {
+            item->flags |= TF_ITEM_NO_FAT_CHAIN;
+        }
+    }
+
+    snap->head.free_clus_num = fs->free_clus_num;
+    uint32_t size            = sizeof(tf_snap_head_t) + snap->head.item_num * sizeof(tf_snap_item_t);
+    return fs->ops->snap_write(fs->ops->ctx, (const uint8_t*)snap, size) == 0 ? 0 : TF_ERR_DISKACCESS;
+}
+
+
+/**
+ * @brief open a path by the snapshot
+ *
+ * @param fs
+ * @param path
+ * @param item result value
+ * @return bool true-found
+ */
+bool tf_snap_find(tf_fs_t* fs, const char* path, tf_item_t* item)
+{
+    tf_snap_t* snap = fs->snap;
+    if (snap == nullptr) {
+        return false;
+    }
+    for (uint32_t i = 0; i < snap->head.item_num; i++) {
+        if (strcmp(snap->items[i].path, path) == 0) {
+            memcpy(item, &snap->items[i].item, sizeof(tf_item_t));
+            return true;
+        }
+    }
+    return false;
+}
+
+
+/**
+ * @brief record an item opened by path, until the snapshot is full
+ *
+ * @param fs
+ * @param path
+ * @param item
+ */
+void tf_snap_add(tf_fs_t* fs, const char* path, const tf_item_t* item)
+{
+    tf_snap_t* snap = fs->snap;
+    if (snap == nullptr || snap->head.item_num == TF_SNAP_ITEM_NUM || strlen(path) >= TF_PATH_LEN_MAX) {
+        return;
+    }
+    if (item->raw_sec == TF_INVALID_SECTOR_ID || (item->flags & TF_ITEM_PENDING)) {   // root dir opened at once
+        return;
+    }
+
+    tf_snap_item_t* si = &snap->items[snap->head.item_num++];
+    strcpy(si->path, path);
+    memcpy(&si->item, item, sizeof(tf_item_t));
+    si->item.flags &= ~TF_ITEM_NO_FAT_CHAIN;   // checked at save
+}
+
+
+/**
+ * @brief some sectors are being written: the snapshot kept by device is voided at the first write, the items whose
+ *        dir item or FAT entries are written are dropped
+ *
+ * @param fs
+ * @param sec_id first sector id
+ * @param count sector count
+ */
+void tf_snap_drop(tf_fs_t* fs, uint32_t sec_id, uint32_t count)
+{
+    tf_snap_t* snap = fs->snap;
+    if (snap == nullptr) {
+        return;
+    }
+    if (snap->kept) {
+        uint32_t none = 0;   // no magic
+        snap->kept    = false;
+        fs->ops->snap_write(fs->ops->ctx, (const uint8_t*)&none, sizeof(none));
+    }
+
+    // clusters whose FAT entries are written, of any FAT
+    uint32_t clus_lo = 0, clus_hi = 0;
+    uint32_t fat_lo = util_max2(sec_id, fs->fat_sec_ofs);
+    uint32_t fat_hi = util_min2(sec_id + count, fs->dat_sec_ofs);
+    if (fat_lo < fat_hi) {
+        uint32_t first = (fat_lo - fs->fat_sec_ofs) % fs->fat_sec_num;
+        uint32_t last  = (fat_hi - 1 - fs->fat_sec_ofs) % fs->fat_sec_num;
+        bool     all   = (fat_hi - fat_lo >= fs->fat_sec_num || last < first);   // across two FATs
+        clus_lo        = all ? 0 : first * (fs->sec_size / 4);
+        clus_hi        = all ? UINT32_MAX : (last + 1) * (fs->sec_size / 4);
+    }
+
+    for (uint32_t i = 0; i < snap->head.item_num;) {
+        tf_item_t* item = &snap->items[i].item;
+        uint32_t   num  = (item->size >> TF_CLUS_SHIFT(fs)) + 1;
+        bool       fat  = (item->flags & TF_ITEM_NO_FAT_CHAIN) && item->first_clus < clus_hi &&
+                   item->first_clus + num > clus_lo;
+        if ((item->raw_sec >= sec_id && item->raw_sec - sec_id < count) || fat) {
+            memcpy(&snap->items[i], &snap->items[--snap->head.item_num], sizeof(tf_snap_item_t));
+            continue;
+        }
+        i++;
+    }
+}
+
+
+/**
+ * @brief FSInfo is written, the snapshot is matched with it at next mount
+ *
+ * @param fs
+ * @param free_count the free count written
+ */
+void tf_snap_stamp(tf_fs_t* fs, uint32_t free_count)
+{
+    tf_snap_t* snap = fs->snap;
+    if (snap != nullptr) {
+        snap->head.fsi_free = (free_count > fs->clus_num_total) ? TF_INVALID_FREE_COUNT : free_count;   // as mount
+        snap->head.fsi_next = fs->next_free_clus;
+    }
+}
@@ -0,0 +1,102 @@
+#include "tinyfat.h"
+#include "tinyfat_priv.h"
+
+#if TF_TRACE_SUPPORTED
+
+static const tf_trace_sink_t* trace_sink;   // nullptr if not recording
+static uint32_t               trace_index;  // records made, the timestamp if no clock
+static bool                   trace_busy;   // sink is writing, its own accesses are not recorded
+static uint16_t               trace_len;    // bytes buffered
+static uint8_t                trace_buf[TF_TRACE_BUF_NUM * TF_TRACE_REC_LEN];
+
+
+/**
+ * @brief give the buffered bytes to the sink
+ *
+ * @return int 0-ok, other-fail
+ */
+static int tf_trace_flush(void)
+{
+    int ret = 0;
+    if (trace_len > 0) {
+        trace_busy = true;
+        ret        = trace_sink->write(trace_sink->ctx, trace_buf, trace_len);
+        trace_busy = false;
+        trace_len  = 0;
+    }
+    return ret == 0 ? 0 : TF_ERR_DISKACCESS;
+}
+
+
+/**
+ * @brief record an access of some continuous sectors, split if the count is too large for a record
+ *
+ * @param fs
+ * @param sec_id first sector id
+ * @param count sector count
+ * @param op TF_TRACE_META/DATA/DIRECT/WRITE
+ */
+void tf_trace_record(const tf_fs_t* fs, uint32_t sec_id, uint32_t count, uint8_t op)
+{
+    if (trace_sink == nullptr || trace_busy) {
+        return;
+    }
+
+    while (count > 0) {
+        uint32_t num = util_min2(count, 0xffff);
+        uint32_t now = (trace_sink->clock != nullptr) ? trace_sink->clock(trace_sink->ctx) : trace_index;
+        uint8_t* rec = &trace_buf[trace_len];
+
+        util_uint2bytes_le(rec + 0, now, 4);
+        util_uint2bytes_le(rec + 4, sec_id, 4);
+        util_uint2bytes_le(rec + 8, num, 2);
+        rec[10] = fs->device;
+        rec[11] = op;
+        trace_len += TF_TRACE_REC_LEN;
+        trace_index++;
+
+        if (trace_len == sizeof(trace_buf)) {
+            tf_trace_flush();
+        }
+        sec_id += num;
+        count -= num;
+    }
+}
+
+
+int tf_trace_start(const tf_trace_sink_t* sink)
+{
+    if (sink == nullptr || sink->write == nullptr) {
+        return TF_ERR_PARAM;
+    }
+    if (trace_sink != nullptr) {   // recording already
+        return TF_ERR_PARAM;
+    }
+
+    trace_sink  = sink;
+    trace_index = 0;
+    util_uint2bytes_le(trace_buf + 0, TF_TRACE_MAGIC, 4);
+    util_uint2bytes_le(trace_buf + 4, TF_TRACE_VERSION, 2);
+    util_uint2bytes_le(trace_buf + 6, TF_TRACE_REC_LEN, 2);
+    trace_len = TF_TRACE_HEAD_LEN;
+
+    int ret = tf_trace_flush();
+    if (ret != 0) {
+        trace_sink = nullptr;
+    }
+    return ret;
+}
+
+
+int tf_trace_stop(void)
+{
+    if (trace_sink == nullptr) {
+        return TF_ERR_PARAM;
+    }
+
+    int ret    = tf_trace_flush();
+    trace_sink = nullptr;
+    return ret;
+}
+
+#endif
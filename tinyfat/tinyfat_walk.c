@@ -0,0 +1,229 @@
+#include "tinyfat.h"
+#include "tinyfat_mem.h"
+#include "tinyfat_path.h"
+#include "tinyfat_priv.h"
+#include "util_queue.h"
+
+#define TF_WALK_ONE_LEVEL 0x80   // private walk flag: the sub dirs are not gone into
+
+typedef struct {
+    util_queue_node_t qnode;
+    uint16_t          depth;    // depth of the items in dir
+    tf_dir_t          dir;      // kept as found, not read yet
+    char              path[];   // path of dir, allocated with the node as long as it is
+} tf_walk_node_t;
+
+typedef struct {
+    util_queue_node_t queue;     // dirs waiting to be scanned
+    tf_walk_cb_t      cb;        //
+    void*             ctx;       // given to cb
+    uint8_t           flags;     // bitmap of TF_WALK_*
+    const char*       pattern;   // sfn pattern the items given to cb should match, nullptr-all
+} tf_walk_t;
+
+
+/**
+ * @brief put a dir to the walk queue, after the dirs of lower levels and the dirs before it on disk
+ *
+ * the dirs queued are all of the current level or the next level, the new one is of the next level, so only the
+ * tail of the queue is searched
+ *
+ * @param queue
+ * @param node
+ */
+static void tf_walk_enqueue(util_queue_node_t* queue, tf_walk_node_t* node)
+{
+    util_queue_node_t* pos = queue;
+    while (pos->prev != queue) {
+        tf_walk_node_t* prev = (tf_walk_node_t*)pos->prev;
+        if (prev->depth != node->depth || prev->dir.first_clus <= node->dir.first_clus) {
+            break;
+        }
+        pos = pos->prev;
+    }
+    util_queue_insert(pos, &node->qnode);
+}
+
+
+/**
+ * @brief read next item of a dir for walk, the items not matching the pattern are skipped before parsed, but the
+ *        dirs to go into
+ *
+ * @param walk
+ * @param dir
+ * @param item result value
+ * @param matched result value, false for the dir not matched, only gone into
+ * @return int 0-ok, positive-has end, other-fail
+ */
+static int tf_walk_read(tf_walk_t* walk, tf_dir_t* dir, tf_item_t* item, bool* matched)
+{
+    if (walk->pattern == nullptr) {
+        *matched = true;
+        return tf_dir_read(dir, item);
+    }
+    return tf_dir_read_match(dir, walk->pattern, !(walk->flags & TF_WALK_ONE_LEVEL), item, matched);
+}
+
+
+/**
+ * @brief scan a dir, give its items to callback, queue its sub dirs
+ *
+ * @param walk
+ * @param node the dir to scan
+ * @return int 0-ok, other-fail or the value of cb
+ */
+static int tf_walk_dir(tf_walk_t* walk, tf_walk_node_t* node)
+{
+    tf_item_t item;
+    bool      matched;
+    char      name[TF_NAME_LEN_MAX];
+    char      path[TF_WALK_PATH_LEN_MAX];
+    uint16_t  path_len = strlen(node->path);
+    int       ret;
+
+    memcpy(path, node->path, path_len);
+    while ((ret = tf_walk_read(walk, &node->dir, &item, &matched)) == 0) {
+        if (item.sfn[0] == '.' || TF_MASK_MATCH(item.attr, TF_ATTR_VOLUME_ID)) {   // ".", "..", volume label
+            continue;
+        }
+        if ((walk->flags & TF_WALK_SKIP_HIDDEN) && (item.attr & (TF_ATTR_HIDDEN | TF_ATTR_SYSTEM))) {
+            continue;
+        }
+
+        // path of item: path + '/' + name
+        tf_item_get_name(&item, name);
+        uint16_t len = path_len;
+        if (len < TF_WALK_PATH_LEN_MAX - 1) {
+            path[len++] = '/';
+        }
+        for (const char* p = name; *p != '\0' && len < TF_WALK_PATH_LEN_MAX - 1; p++) {
+            path[len++] = *p;
+        }
+        path[len] = '\0';
+
+        if (!TF_MASK_MATCH(item.attr, TF_ATTR_DIRECTORY)) {
+            ret = (walk->flags & TF_WALK_DIRS_ONLY) ? 0 : walk->cb(walk->ctx, path, &item, node->depth);
+            if (ret != 0 && ret != TF_WALK_SKIP) {   // nothing to skip in a file
+                return ret;
+            }
+            continue;
+        }
+        if (walk->flags & TF_WALK_ONE_LEVEL) {
+            ret = walk->cb(walk->ctx, path, &item, node->depth);
+            if (ret != 0 && ret != TF_WALK_SKIP) {
+                return ret;
+            }
+            continue;
+        }
+
+        // kept before cb, the dir may be read by cb
+        tf_walk_node_t* sub = (tf_walk_node_t*)tf_malloc(sizeof(tf_walk_node_t) + len + 1);
+        if (sub == nullptr) {
+            return TF_ERR_NO_MEM;
+        }
+        sub->depth = node->depth + 1;
+        memcpy(&sub->dir, &item, sizeof(tf_item_t));
+        memcpy(sub->path, path, len + 1);
+
+        ret = matched ? walk->cb(walk->ctx, path, &item, node->depth) : 0;
+        if (ret != 0) {
+            tf_free(sub);
+            if (ret != TF_WALK_SKIP) {
+                return ret;
+            }
+            continue;
+        }
+        tf_walk_enqueue(&walk->queue, sub);
+    }
+    return ret < 0 ? ret : 0;
+}
+
+
+/**
+ * @brief walk the dirs in queue until it is empty, the queue is emptied if failed
+ *
+ * @param walk
+ * @return int 0-ok, other-fail or the value of cb
+ */
+static int tf_walk_queue(tf_walk_t* walk)
+{
+    int ret = 0;
+
+    while (!util_queue_empty(&walk->queue)) {
+        tf_walk_node_t* node = (tf_walk_node_t*)walk->queue.next;
+        util_queue_remove(&node->qnode);
+        if (ret == 0) {
+            ret = tf_walk_dir(walk, node);
+        }
+        tf_free(node);
+    }
+    return ret;
+}
+
+
+/**
+ * @brief walk from a dir, see `tf_walk`
+ *
+ * @param walk
+ * @param path
+ * @return int 0-ok, other-fail or the value of cb
+ */
+static int tf_walk_start(tf_walk_t* walk, const char* path)
+{
+    uint16_t len = util_min2(strlen(path), TF_WALK_PATH_LEN_MAX - 1);
+    while (len > 0 && path[len - 1] == '/') {   // names are appended with '/'
+        len--;
+    }
+
+    tf_walk_node_t* node = (tf_walk_node_t*)tf_malloc(sizeof(tf_walk_node_t) + len + 1);
+    if (node == nullptr) {
+        return TF_ERR_NO_MEM;
+    }
+
+    int ret = TF_IO_WAIT(tf_dir_open(path, &node->dir));
+    if (ret == 0 && !TF_MASK_MATCH(node->dir.attr, TF_ATTR_DIRECTORY)) {
+        ret = TF_ERR_PARAM;
+    }
+    if (ret != 0) {
+        tf_free(node);
+        return ret;
+    }
+
+    memcpy(node->path, path, len);
+    node->path[len] = '\0';
+    node->depth     = 1;
+
+    util_queue_init(&walk->queue);
+    util_queue_insert(&walk->queue, &node->qnode);
+    return TF_IO_WAIT(tf_walk_queue(walk));
+}
+
+
+int tf_walk(const char* path, tf_walk_cb_t cb, void* ctx, uint8_t flags)
+{
+    if (path == nullptr || cb == nullptr) {
+        return TF_ERR_PARAM;
+    }
+
+    tf_walk_t walk = {.cb = cb, .ctx = ctx, .flags = flags & ~TF_WALK_ONE_LEVEL, .pattern = nullptr};
+    return TF_PROF(TF_PROF_WALK, tf_walk_start(&walk, path));
+}
+
+
+int tf_find(const char* path, const char* glob, uint8_t flags, tf_walk_cb_t cb, void* ctx)
+{
+    if (path == nullptr || glob == nullptr || cb == nullptr) {
+        return TF_ERR_PARAM;
+    }
+
+    char pattern[TF_SFN_LEN - 1];
+    if (tf_sfn_pattern(glob, pattern) != 0) {
+        return TF_ERR_FNAME_IVALID;
+    }
+
+    tf_walk_t walk = {.cb = cb, .ctx = ctx, .flags = flags & ~TF_WALK_ONE_LEVEL, .pattern = pattern};
+    if (!(flags & TF_FIND_RECURSIVE)) {
+        walk.flags |= TF_WALK_ONE_LEVEL;
+    }
+    return TF_PROF(TF_PROF_WALK, tf_walk_start(&walk, path));
+}
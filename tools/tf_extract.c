@@ -0,0 +1,215 @@
+// extract a volume or a subtree out of an image to the host, through the same code as the devices
+//
+// usage: tf_extract <image> <outdir> [path]
+//   path of the dir or file to extract, `/` by default
+//   files are read with a large buffer, so the sectors go to it directly in bursts, and written with large writes;
+//   the size of each file written is checked against its dir item
+#define _FILE_OFFSET_BITS 64   // off_t of fseeko/ftello, for images and files over 2 GiB
+#include "tinyfat.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifdef _WIN32
+#include <direct.h>
+#include <windows.h>
+#define host_mkdir(path)    _mkdir(path)
+#define host_fseek(fp, ofs) _fseeki64(fp, (int64_t)(ofs), SEEK_SET)
+#define host_ftell(fp)      _ftelli64(fp)
+#else
+#include <sys/stat.h>
+#include <sys/types.h>
+#define host_mkdir(path)    mkdir(path, 0777)
+#define host_fseek(fp, ofs) fseeko(fp, (off_t)(ofs), SEEK_SET)
+#define host_ftell(fp)      ftello(fp)
+#endif
+
+#define EXTRACT_DISK_ID  0
+#define EXTRACT_BUF_SIZE (1024 * 1024)   // bytes a read and a write
+#define EXTRACT_PATH_MAX 512             // host path length
+
+typedef struct {
+    const char* outdir;
+    uint16_t    strip;   // bytes of the walk paths not put to outdir, the parent of the dir extracted
+    uint8_t*    buffer;
+    uint32_t    file_num;
+    uint32_t    dir_num;
+    uint32_t    fail_num;
+    uint64_t    bytes;
+} extract_ctx_t;
+
+
+// image backend, ctx is the FILE of image
+static int image_read_multi(void* ctx, uint32_t sec_id, uint32_t count, uint16_t sec_size, uint8_t* data)
+{
+    FILE* image = (FILE*)ctx;
+    if (host_fseek(image, (uint64_t)sec_id * sec_size) != 0) {
+        return -1;
+    }
+    return fread(data, sec_size, count, image) == count ? 0 : -1;
+}
+
+static int image_read(void* ctx, uint32_t sec_id, uint16_t sec_size, uint8_t* data)
+{
+    return image_read_multi(ctx, sec_id, 1, sec_size, data);
+}
+
+static tf_disk_ops_t image_ops = {
+    .read       = image_read,
+    .read_multi = image_read_multi,
+};
+
+
+// wall clock in seconds, the extraction is bound by I/O, not by CPU
+static double host_seconds(void)
+{
+#ifdef _WIN32
+    LARGE_INTEGER freq, now;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&now);
+    return (double)now.QuadPart / freq.QuadPart;
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+#endif
+}
+
+
+/**
+ * @brief copy a file of image to the host
+ *
+ * @param ec
+ * @param file
+ * @param out host path
+ * @return int 0-ok, other-fail
+ */
+static int extract_file(extract_ctx_t* ec, tf_file_t* file, const char* out)
+{
+    FILE* fp = fopen(out, "wb");
+    if (fp == nullptr) {
+        return TF_ERR_PARAM;
+    }
+
+    uint64_t done = 0;
+    int      ret;
+    while ((ret = tf_file_read(file, ec->buffer, EXTRACT_BUF_SIZE)) > 0) {
+        if (fwrite(ec->buffer, 1, ret, fp) != (size_t)ret) {
+            ret = TF_ERR_DISKACCESS;
+            break;
+        }
+        done += ret;
+    }
+    if (ret == 0 && (done != file->size || host_ftell(fp) != (int64_t)file->size)) {   // chain shorter than size
+        ret = TF_ERR_DISKACCESS;
+    }
+    if (fclose(fp) != 0 && ret == 0) {
+        ret = TF_ERR_DISKACCESS;
+    }
+    ec->bytes += done;
+    return ret < 0 ? ret : 0;
+}
+
+
+/**
+ * @brief walk callback, dirs are created before the items in them are given; the path under the parent of the dir
+ *        extracted is kept, so "/etc/x" of "/etc" goes to "outdir/etc/x"
+ */
+static int extract_item(void* ctx, const char* path, tf_item_t* item, uint16_t depth)
+{
+    extract_ctx_t* ec = (extract_ctx_t*)ctx;
+    char           out[EXTRACT_PATH_MAX];
+
+    util_unused(depth);
+    if (strlen(path) >= TF_WALK_PATH_LEN_MAX - 1) {   // may be cut, not written to a wrong file
+        printf("ERROR %s: path too long\n", path);
+        ec->fail_num++;
+        return TF_WALK_SKIP;
+    }
+    snprintf(out, sizeof(out), "%s%s", ec->outdir, path + ec->strip);
+
+    if (item->attr & TF_ATTR_DIRECTORY) {
+        host_mkdir(out);   // may exist
+        ec->dir_num++;
+        return 0;
+    }
+
+    int ret = extract_file(ec, item, out);
+    if (ret != 0) {
+        printf("ERROR %s: %d\n", path, ret);
+        ec->fail_num++;
+    } else {
+        ec->file_num++;
+    }
+    return 0;
+}
+
+
+int main(int argc, char* argv[])
+{
+    if (argc < 3) {
+        printf("usage: tf_extract <image> <outdir> [path]\n");
+        return 0;
+    }
+
+    const char*   path = (argc > 3) ? argv[3] : "/";
+    extract_ctx_t ec   = {.outdir = argv[2]};
+
+    image_ops.ctx = fopen(argv[1], "rb");
+    if (image_ops.ctx == nullptr) {
+        printf("ERROR open %s\n", argv[1]);
+        return 1;
+    }
+    ec.buffer = (uint8_t*)malloc(EXTRACT_BUF_SIZE);
+    if (ec.buffer == nullptr) {
+        printf("ERROR no memory\n");
+        return 1;
+    }
+
+    int ret = tf_mount(EXTRACT_DISK_ID, 'X', &image_ops);
+    if (ret != 0) {
+        printf("ERROR mount %d\n", ret);
+        return 1;
+    }
+
+    host_mkdir(ec.outdir);
+    double start = host_seconds();
+
+    tf_item_t item;
+    ret = tf_item_open(path, &item);
+    if (ret == 0 && (item.attr & TF_ATTR_DIRECTORY)) {
+        char     root[EXTRACT_PATH_MAX];
+        uint16_t len = strlen(path);
+        while (len > 0 && path[len - 1] == '/') {   // as the walk paths
+            len--;
+        }
+        ec.strip = len;   // root dir, "" or a drive like "x:"
+        for (uint16_t i = 0; i < len; i++) {   // from the last '/', before the name of the dir
+            if (path[i] == '/') {
+                ec.strip = i;
+            }
+        }
+        if (len > ec.strip) {   // the dir itself, not the root dir
+            snprintf(root, sizeof(root), "%s%.*s", ec.outdir, len - ec.strip, path + ec.strip);
+            host_mkdir(root);
+        }
+        ret = tf_walk(path, extract_item, &ec, 0);
+    } else if (ret == 0) {   // a file, to outdir with its name
+        char name[TF_NAME_LEN_MAX + 1] = "/";
+        tf_item_get_name(&item, name + 1);
+        ret = extract_item(&ec, name, &item, 1);
+    }
+
+    double sec = host_seconds() - start;
+    printf("files: %u, dirs: %u, failed: %u, bytes: %llu, time: %.3f s", ec.file_num, ec.dir_num, ec.fail_num,
+           (unsigned long long)ec.bytes, sec);
+    printf(sec > 0 ? ", %.1f MB/s\n" : "\n", ec.bytes / sec / (1024 * 1024));
+    if (ret != 0) {
+        printf("ERROR %d\n", ret);
+    }
+
+    tf_unmount(EXTRACT_DISK_ID);
+    fclose((FILE*)image_ops.ctx);
+    free(ec.buffer);
+    return (ret != 0 || ec.fail_num != 0) ? 1 : 0;
+}
@@ -0,0 +1,324 @@
+// replay a disk access trace of tinyfat, to choose the cache size, policy and read-ahead window on a host
+//
+// usage: tf_replay <trace> [-c sizes] [-r windows] [-l latency_us] [-s sector_us]
+//   -c cache sizes in sectors to try, such as `2,4,8,16`
+//   -r read-ahead windows in sectors to try, extra sectors read with a missed data sector, such as `0,4,8`
+//   -l cost of an i/o call in us, for the projected i/o time
+//   -s cost of a sector transfer in us, for the projected i/o time
+#include "tinyfat.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define REPLAY_LIST_MAX  16     // values of an option list
+#define REPLAY_CACHE_MAX 1024   // max cache size to try
+
+#define REPLAY_POLICY_LRU  0   // plain LRU
+#define REPLAY_POLICY_META 1   // tinyfat pool: data first, then meta loaded once, then hot meta, LRU in each
+
+typedef struct {
+    uint32_t time;
+    uint32_t sec_id;
+    uint16_t count;
+    uint8_t  device;
+    uint8_t  op;
+} replay_rec_t;
+
+typedef struct {
+    bool     used;
+    uint8_t  device;
+    uint32_t sec_id;
+    uint32_t stamp;   // last access
+    uint8_t  kind;    // 0-data, 1-meta
+    bool     hot;     // meta accessed again
+} replay_buf_t;
+
+typedef struct {
+    uint32_t access;     // sectors accessed through cache
+    uint32_t hit;        // sectors found in cache
+    uint32_t read_io;    // read calls to device
+    uint32_t read_sec;   // sectors read from device
+    uint32_t write_io;   // write calls to device
+    uint32_t write_sec;  // sectors written to device
+} replay_stat_t;
+
+static replay_buf_t cache[REPLAY_CACHE_MAX];
+static uint32_t     cache_size;
+static uint32_t     cache_stamp;
+static uint8_t      cache_policy;
+
+
+/**
+ * @brief parse a list of numbers separated by ','
+ *
+ * @param str
+ * @param list result value
+ * @return int count of numbers
+ */
+static int replay_parse_list(const char* str, uint32_t* list)
+{
+    int num = 0;
+    while (*str != '\0' && num < REPLAY_LIST_MAX) {
+        char* end;
+        list[num++] = strtoul(str, &end, 0);
+        str         = (*end == ',') ? end + 1 : end + strlen(end);
+    }
+    return num;
+}
+
+
+/**
+ * @brief load all records of a trace file
+ *
+ * @param path
+ * @param num result value, record count
+ * @return replay_rec_t* nullptr if failed
+ */
+static replay_rec_t* replay_load(const char* path, uint32_t* num)
+{
+    FILE* fp = fopen(path, "rb");
+    if (fp == nullptr) {
+        printf("ERROR open %s\n", path);
+        return nullptr;
+    }
+
+    uint8_t head[TF_TRACE_HEAD_LEN];
+    if (fread(head, 1, sizeof(head), fp) != sizeof(head) || util_bytes2uint_le(head, 4) != TF_TRACE_MAGIC ||
+        util_bytes2uint_le(head + 4, 2) != TF_TRACE_VERSION || util_bytes2uint_le(head + 6, 2) != TF_TRACE_REC_LEN) {
+        printf("ERROR %s is not a trace of this version\n", path);
+        fclose(fp);
+        return nullptr;
+    }
+
+    fseek(fp, 0, SEEK_END);
+    *num = (ftell(fp) - TF_TRACE_HEAD_LEN) / TF_TRACE_REC_LEN;
+    fseek(fp, TF_TRACE_HEAD_LEN, SEEK_SET);
+
+    replay_rec_t* recs = (replay_rec_t*)malloc((*num + 1) * sizeof(replay_rec_t));
+    for (uint32_t i = 0; recs != nullptr && i < *num; i++) {
+        uint8_t raw[TF_TRACE_REC_LEN];
+        if (fread(raw, 1, sizeof(raw), fp) != sizeof(raw)) {
+            *num = i;
+            break;
+        }
+        recs[i].time   = util_bytes2uint_le(raw + 0, 4);
+        recs[i].sec_id = util_bytes2uint_le(raw + 4, 4);
+        recs[i].count  = util_bytes2uint_le(raw + 8, 2);
+        recs[i].device = raw[10];
+        recs[i].op     = raw[11];
+    }
+    fclose(fp);
+    return recs;
+}
+
+
+/**
+ * @brief find a sector in cache
+ *
+ * @param device
+ * @param sec_id
+ * @return replay_buf_t* nullptr if not cached
+ */
+static replay_buf_t* replay_find(uint8_t device, uint32_t sec_id)
+{
+    for (uint32_t i = 0; i < cache_size; i++) {
+        if (cache[i].used && cache[i].device == device && cache[i].sec_id == sec_id) {
+            return &cache[i];
+        }
+    }
+    return nullptr;
+}
+
+
+/**
+ * @brief choose the buffer to reuse by policy, as `tf_cache_victim` does for the meta policy
+ *
+ * @param keep the buffer in use, not reused
+ * @return replay_buf_t*
+ */
+static replay_buf_t* replay_victim(const replay_buf_t* keep)
+{
+    replay_buf_t* victim      = nullptr;
+    uint8_t       victim_rank = 0;
+
+    for (uint32_t i = 0; i < cache_size; i++) {
+        replay_buf_t* buf = &cache[i];
+        if (!buf->used) {
+            return buf;
+        }
+        if (buf == keep) {
+            continue;
+        }
+
+        uint8_t rank = (cache_policy == REPLAY_POLICY_META) ? buf->kind + buf->hot : 0;
+        if (victim == nullptr || rank < victim_rank || (rank == victim_rank && buf->stamp < victim->stamp)) {
+            victim      = buf;
+            victim_rank = rank;
+        }
+    }
+    return victim;
+}
+
+
+/**
+ * @brief mark a meta buffer hot, the least recently used hot one is cooled if there are too many
+ *
+ * @param hot
+ */
+static void replay_promote(replay_buf_t* hot)
+{
+    replay_buf_t* oldest = nullptr;
+    uint32_t      num    = 0;
+
+    hot->hot = true;
+    for (uint32_t i = 0; i < cache_size; i++) {
+        if (cache[i].used && cache[i].hot) {
+            num++;
+            if (oldest == nullptr || cache[i].stamp < oldest->stamp) {
+                oldest = &cache[i];
+            }
+        }
+    }
+    if (num > cache_size * 3 / 4) {
+        oldest->hot = false;
+    }
+}
+
+
+/**
+ * @brief put a sector to cache
+ *
+ * @param device
+ * @param sec_id
+ * @param kind
+ * @param keep the buffer in use, not reused
+ * @return replay_buf_t*
+ */
+static replay_buf_t* replay_insert(uint8_t device, uint32_t sec_id, uint8_t kind, const replay_buf_t* keep)
+{
+    replay_buf_t* buf = replay_victim(keep);
+    buf->used         = true;
+    buf->device       = device;
+    buf->sec_id       = sec_id;
+    buf->stamp        = ++cache_stamp;
+    buf->kind         = kind;
+    buf->hot          = false;
+    return buf;
+}
+
+
+/**
+ * @brief replay all records with a cache configuration
+ *
+ * @param recs
+ * @param num record count
+ * @param window read-ahead window
+ * @param stat result value
+ */
+static void replay_run(const replay_rec_t* recs, uint32_t num, uint32_t window, replay_stat_t* stat)
+{
+    replay_buf_t* last = nullptr;   // buffer accessed last, a repeated access of it is not a reuse
+
+    memset(cache, 0, sizeof(cache));
+    memset(stat, 0, sizeof(replay_stat_t));
+    cache_stamp = 0;
+
+    for (uint32_t i = 0; i < num; i++) {
+        const replay_rec_t* rec = &recs[i];
+
+        if (rec->op == TF_TRACE_DIRECT) {
+            stat->read_io++;
+            stat->read_sec += rec->count;
+            continue;
+        }
+        if (rec->op == TF_TRACE_WRITE) {   // write through, the cached copies are updated
+            stat->write_io++;
+            stat->write_sec += rec->count;
+            continue;
+        }
+
+        uint8_t kind = (rec->op == TF_TRACE_META);
+        for (uint32_t s = 0; s < rec->count; s++) {
+            uint32_t      sec_id = rec->sec_id + s;
+            replay_buf_t* buf    = replay_find(rec->device, sec_id);
+
+            stat->access++;
+            if (buf != nullptr) {
+                stat->hit++;
+                buf->stamp = ++cache_stamp;
+                buf->kind |= kind;
+                if (cache_policy == REPLAY_POLICY_META && buf->kind && !buf->hot && buf != last) {
+                    replay_promote(buf);
+                }
+                last = buf;
+                continue;
+            }
+
+            // missed, the data sectors after it are read together
+            uint32_t ahead = kind ? 0 : util_min2(window, cache_size - 1);
+            stat->read_io++;
+            stat->read_sec += 1 + ahead;
+            buf = replay_insert(rec->device, sec_id, kind, last);
+            for (uint32_t k = 1; k <= ahead; k++) {
+                if (replay_find(rec->device, sec_id + k) == nullptr) {
+                    replay_insert(rec->device, sec_id + k, 0, buf);
+                }
+            }
+            last = buf;
+        }
+    }
+}
+
+
+int main(int argc, char* argv[])
+{
+    uint32_t sizes[REPLAY_LIST_MAX]   = {2, 4, 8, 16, 32};
+    uint32_t windows[REPLAY_LIST_MAX] = {0};
+    int      size_num                 = 5;
+    int      window_num               = 1;
+    uint32_t latency_us               = 100;
+    uint32_t sector_us                = 10;
+
+    if (argc < 2) {
+        printf("usage: tf_replay <trace> [-c sizes] [-r windows] [-l latency_us] [-s sector_us]\n");
+        return 0;
+    }
+    for (int i = 2; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "-c") == 0) {
+            size_num = replay_parse_list(argv[i + 1], sizes);
+        } else if (strcmp(argv[i], "-r") == 0) {
+            window_num = replay_parse_list(argv[i + 1], windows);
+        } else if (strcmp(argv[i], "-l") == 0) {
+            latency_us = strtoul(argv[i + 1], nullptr, 0);
+        } else if (strcmp(argv[i], "-s") == 0) {
+            sector_us = strtoul(argv[i + 1], nullptr, 0);
+        }
+    }
+
+    uint32_t      num;
+    replay_rec_t* recs = replay_load(argv[1], &num);
+    if (recs == nullptr) {
+        return 1;
+    }
+    printf("records: %u, time: %u ~ %u\n", num, num > 0 ? recs[0].time : 0, num > 0 ? recs[num - 1].time : 0);
+    printf("policy  cache  ahead   hit%%    reads  sectors   writes  sectors   time(ms)\n");
+
+    for (uint8_t policy = REPLAY_POLICY_LRU; policy <= REPLAY_POLICY_META; policy++) {
+        for (int c = 0; c < size_num; c++) {
+            for (int w = 0; w < window_num; w++) {
+                replay_stat_t stat;
+                cache_policy = policy;
+                cache_size   = util_min2(util_max2(sizes[c], 2), REPLAY_CACHE_MAX);
+                replay_run(recs, num, windows[w], &stat);
+
+                uint64_t time_us = (uint64_t)(stat.read_io + stat.write_io) * latency_us +
+                                   (uint64_t)(stat.read_sec + stat.write_sec) * sector_us;
+                printf("%-6s %6u %6u %6.2f %8u %8u %8u %8u %10.1f\n", policy == REPLAY_POLICY_LRU ? "lru" : "meta",
+                       cache_size, windows[w], stat.access ? 100.0 * stat.hit / stat.access : 0.0, stat.read_io,
+                       stat.read_sec, stat.write_io, stat.write_sec, time_us / 1000.0);
+            }
+        }
+    }
+    free(recs);
+    return 0;
+}
@@ -89,6 +89,20 @@ static inline uint32_t util_bytes2uint_be(uint8_t* buf, uint8_t size)
     return value.u32;
 }
 
+/**
+ * @brief uint to bytes, little endian
+ *
+ * @param buf
+ * @param value
+ * @param size
+ */
+static inline void util_uint2bytes_le(uint8_t* buf, uint32_t value, uint8_t size)
+{
+    for (uint8_t i = 0; i < size; i++) {
+        buf[i] = (value >> (8 * i)) & 0xff;
+    }
+}
+
 #ifdef HOST_DEBUG
 #include <stdio.h>
 #define util_printf printf